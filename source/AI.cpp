@@ -13,6 +13,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "AI.h"
 
 #include "Armament.h"
+#include "AsteroidField.h"
 #include "Audio.h"
 #include "Command.h"
 #include "DistanceMap.h"
@@ -30,9 +31,9 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Ship.h"
 #include "ShipEvent.h"
 #include "System.h"
+#include "WorkerPool.h"
 
-#include <SDL2/SDL.h>
-
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <set>
@@ -41,6 +42,31 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 using namespace std;
 
 namespace {
+	// IDs of the ship attributes that the AI checks.
+	const int AFTERBURNER_ENERGY = Outfit::AttributeID("afterburner energy");
+	const int AFTERBURNER_FUEL = Outfit::AttributeID("afterburner fuel");
+	const int AFTERBURNER_HEAT = Outfit::AttributeID("afterburner heat");
+	const int AFTERBURNER_THRUST = Outfit::AttributeID("afterburner thrust");
+	const int ATMOSPHERE_SCAN = Outfit::AttributeID("atmosphere scan");
+	const int CARGO_SCAN = Outfit::AttributeID("cargo scan");
+	const int CARGO_SCAN_POWER = Outfit::AttributeID("cargo scan power");
+	const int CLOAK = Outfit::AttributeID("cloak");
+	const int CLOAKING_FUEL = Outfit::AttributeID("cloaking fuel");
+	const int DRAG = Outfit::AttributeID("drag");
+	const int ENERGY_CAPACITY = Outfit::AttributeID("energy capacity");
+	const int ENERGY_CONSUMPTION = Outfit::AttributeID("energy consumption");
+	const int ENERGY_GENERATION = Outfit::AttributeID("energy generation");
+	const int FUEL_CAPACITY = Outfit::AttributeID("fuel capacity");
+	const int HYPERDRIVE = Outfit::AttributeID("hyperdrive");
+	const int JUMP_DRIVE = Outfit::AttributeID("jump drive");
+	const int JUMP_SPEED = Outfit::AttributeID("jump speed");
+	const int OUTFIT_SCAN = Outfit::AttributeID("outfit scan");
+	const int OUTFIT_SCAN_POWER = Outfit::AttributeID("outfit scan power");
+	const int RAMSCOOP = Outfit::AttributeID("ramscoop");
+	const int REVERSE_THRUST = Outfit::AttributeID("reverse thrust");
+	const int SCRAM_DRIVE = Outfit::AttributeID("scram drive");
+	const int SOLAR_COLLECTION = Outfit::AttributeID("solar collection");
+	
 	const Command &AutopilotCancelKeys()
 	{
 		static const Command keys(Command::LAND | Command::JUMP | Command::BOARD | Command::AFTERBURNER
@@ -52,7 +78,7 @@ namespace {
 	bool IsStranded(const Ship &ship)
 	{
 		return ship.GetSystem() && !ship.IsEnteringHyperspace() && !ship.GetSystem()->HasFuelFor(ship)
-			&& ship.JumpFuel() && ship.Attributes().Get("fuel capacity") && !ship.JumpsRemaining();
+			&& ship.JumpFuel() && ship.Attributes().Get(FUEL_CAPACITY) && !ship.JumpsRemaining();
 	}
 	
 	bool CanBoard(const Ship &ship, const Ship &target)
@@ -72,16 +98,46 @@ namespace {
 		return min(a, 360. - a);
 	}
 	
+	// The target and weapons commands that the AI picked for one ship, before
+	// they are applied to it.
+	class Decision {
+	public:
+		Ship *ship = nullptr;
+		bool findTarget = false;
+		bool opportunistic = false;
+		shared_ptr<Ship> target;
+		Command command;
+	};
+	// Number of ships in each block of decisions handed to a worker thread.
+	const int DECISION_BLOCK = 16;
+	
 	const double MAX_DISTANCE_FROM_CENTER = 10000.;
 	// Constance for the invisible fence timer.
 	const int FENCE_DECAY = 4;
 	const int FENCE_MAX = 600;
+	
+	// Ships are sorted into a grid with large cells, since most ship queries
+	// cover a wide area.
+	const int SHIP_GRID_CELL_SIZE = 512;
+	const int SHIP_GRID_CELLS = 64;
+	// Buffer for the results of a ship grid query, for each thread that is
+	// choosing targets or aiming.
+	thread_local vector<int> nearbyShips;
+	
+	// Get the hash table index for an entry in the record of actions.
+	size_t ActionHash(uint64_t actor, const Government *government, uint64_t target)
+	{
+		uint64_t key = actor * 0x9E3779B97F4A7C15ULL;
+		key ^= reinterpret_cast<uintptr_t>(government) + (key >> 29);
+		key = (key ^ target) * 0xBF58476D1CE4E5B9ULL;
+		return key ^ (key >> 31);
+	}
 }
 
 
 
-AI::AI(const List<Ship> &ships, const List<Minable> &minables, const List<Flotsam> &flotsam)
-	: ships(ships), minables(minables), flotsam(flotsam)
+AI::AI(const List<Ship> &ships, const AsteroidField &asteroids, const List<Flotsam> &flotsam)
+	: ships(ships), asteroids(asteroids), flotsam(flotsam), shipGrid(SHIP_GRID_CELL_SIZE, SHIP_GRID_CELLS)
 {
 }
 
@@ -113,14 +169,14 @@ void AI::IssueMoveTarget(const PlayerInfo &player, const Point &target, const Sy
 
 
 // Commands issued via the keyboard (mostly, to the flagship).
-void AI::UpdateKeys(PlayerInfo &player, Command &clickCommands, bool isActive)
+void AI::UpdateKeys(PlayerInfo &player, const Command &keys, bool shift, Command &clickCommands, bool isActive)
 {
-	shift = (SDL_GetModState() & KMOD_SHIFT);
+	this->shift = shift;
 	escortsUseAmmo = Preferences::Has("Escorts expend ammo");
 	escortsAreFrugal = Preferences::Has("Escorts use ammo frugally");
 	
 	Command oldHeld = keyHeld;
-	keyHeld.ReadKeyboard();
+	keyHeld = keys;
 	keyStuck |= clickCommands;
 	clickCommands.Clear();
 	keyDown = keyHeld.AndNot(oldHeld);
@@ -145,7 +201,7 @@ void AI::UpdateKeys(PlayerInfo &player, Command &clickCommands, bool isActive)
 	// Only toggle the "cloak" command if one of your ships has a cloaking device.
 	if(keyDown.Has(Command::CLOAK))
 		for(const auto &it : player.Ships())
-			if(!it->IsParked() && it->Attributes().Get("cloak"))
+			if(!it->IsParked() && it->Attributes().Get(CLOAK))
 			{
 				isCloaking = !isCloaking;
 				Messages::Add(isCloaking ? "Engaging cloaking device." : "Disengaging cloaking device.");
@@ -212,19 +268,23 @@ void AI::UpdateEvents(const list<ShipEvent> &events)
 {
 	for(const ShipEvent &event : events)
 	{
-		if(event.Actor() && event.Target())
-			actions[event.Actor()][event.Target()] |= event.Type();
-		if(event.ActorGovernment() && event.Target())
-			governmentActions[event.ActorGovernment()][event.Target()] |= event.Type();
-		if(event.ActorGovernment()->IsPlayer() && event.Target())
+		if(!event.Target())
+			continue;
+		
+		const Ship &target = *event.Target();
+		if(event.Actor())
+			actions.Add(event.Actor().get(), nullptr, target, event.Type());
+		if(event.ActorGovernment())
 		{
-			int &bitmap = playerActions[event.Target()];
-			int newActions = event.Type() - (event.Type() & bitmap);
-			bitmap |= event.Type();
-			// If you provoke the same ship twice, it should have an effect both times.
-			if(event.Type() & ShipEvent::PROVOKE)
-				newActions |= ShipEvent::PROVOKE;
-			event.TargetGovernment()->Offend(newActions, event.Target()->RequiredCrew());
+			int bitmap = actions.Add(nullptr, event.ActorGovernment(), target, event.Type());
+			if(event.ActorGovernment()->IsPlayer())
+			{
+				int newActions = event.Type() - (event.Type() & bitmap);
+				// If you provoke the same ship twice, it should have an effect both times.
+				if(event.Type() & ShipEvent::PROVOKE)
+					newActions |= ShipEvent::PROVOKE;
+				event.TargetGovernment()->Offend(newActions, target.RequiredCrew());
+			}
 		}
 	}
 }
@@ -233,20 +293,23 @@ void AI::UpdateEvents(const list<ShipEvent> &events)
 
 void AI::Clean()
 {
-	actions.clear();
-	governmentActions.clear();
-	playerActions.clear();
-	shipStrength.clear();
-	swarmCount.clear();
-	miningAngle.clear();
-	miningTime.clear();
-	appeasmentThreshold.clear();
+	actions.Clear();
+	for(ShipState &state : states)
+	{
+		state.strength = 0;
+		state.swarmCount = 0;
+		state.hasMiningAngle = false;
+		state.miningTime = 0;
+		state.appeasementThreshold = 0.;
+	}
 }
 
 
 
 void AI::Step(const PlayerInfo &player)
 {
+	IndexShips();
+	
 	// First, figure out the comparative strengths of the present governments.
 	map<const Government *, int64_t> strength;
 	for(const auto &it : ships)
@@ -277,7 +340,7 @@ void AI::Step(const PlayerInfo &player)
 		if(!gov || it->GetSystem() != player.GetSystem() || it->IsDisabled() || Random::Int(60))
 			continue;
 		
-		int64_t &strength = shipStrength[it.get()];
+		int64_t &strength = State(*it).strength;
 		for(const auto &oit : ships)
 		{
 			const Government *ogov = oit->GetGovernment();
@@ -290,20 +353,14 @@ void AI::Step(const PlayerInfo &player)
 	}
 	
 	// Update the counts of how long ships have been outside the "invisible fence."
-	// If a ship ceases to exist, this also ensures that it will be removed from
-	// the fence count map after a few seconds.
-	for(auto it = fenceCount.begin(); it != fenceCount.end(); )
-	{
-		it->second -= FENCE_DECAY;
-		if(it->second < 0)
-			it = fenceCount.erase(it);
-		else
-			++it;
-	}
+	// This includes ships that are not in the list, so that a ship's count
+	// has decayed if it comes back.
+	for(ShipState &state : states)
+		state.fenceCount = max(0, state.fenceCount - FENCE_DECAY);
 	for(const auto &it : ships)
 		if(it->Position().Length() >= MAX_DISTANCE_FROM_CENTER)
 		{
-			int &value = fenceCount[&*it];
+			int &value = State(*it).fenceCount;
 			value = min(FENCE_MAX, value + FENCE_DECAY + 1);
 		}
 	
@@ -312,6 +369,96 @@ void AI::Step(const PlayerInfo &player)
 	int targetTurn = 0;
 	int minerCount = 0;
 	bool opportunisticEscorts = !Preferences::Has("Turrets focus fire");
+	
+	// Figure out which ships will pick targets and aim and fire their weapons
+	// in this step. Anything that changes a ship's own parent or cargo before it
+	// picks a target must be done now, so that the decisions below see it.
+	vector<Decision> decisions;
+	decisions.reserve(ships.size());
+	for(const auto &it : ships)
+	{
+		// Cache each ship's collision mask for this step, because AutoFire()
+		// would otherwise do so from several threads at once.
+		it->GetMask(step);
+		
+		if(!it->GetSystem() || it.get() == flagship)
+			continue;
+		if(it->IsDisabled() || ((it->IsDestroyed() || it->GetPersonality().IsDerelict()) && IsStranded(*it)))
+			continue;
+		
+		// If your parent is destroyed, you are no longer an escort.
+		const Ship *parent = it->Parent();
+		if(parent && parent->IsDestroyed())
+		{
+			parent = nullptr;
+			it->SetParent(nullptr);
+		}
+		
+		// Special actions when a ship is near death:
+		const Personality &personality = it->GetPersonality();
+		double health = .5 * it->Shields() + it->Hull();
+		if(health < 1.)
+		{
+			if(parent && personality.IsCoward())
+			{
+				// Cowards abandon their fleets.
+				parent = nullptr;
+				it->SetParent(nullptr);
+			}
+			if(personality.IsAppeasing() && it->Cargo().Used())
+			{
+				double &threshold = State(*it).appeasementThreshold;
+				if(1. - health > threshold)
+				{
+					// "Appeasing" ships will dump some fraction of their cargo.
+					int toDump = 11 + (1. - health) * .5 * it->Cargo().Size();
+					for(const auto &commodity : it->Cargo().Commodities())
+					{
+						it->Jettison(commodity.first, min(commodity.second, toDump));
+						toDump -= commodity.second;
+						if(toDump <= 0)
+							break;
+					}
+					Messages::Add(it->GetGovernment()->GetName() + " ship \"" + it->Name()
+						+ "\": Please, just take my cargo and leave me alone.");
+					threshold = (1. - health) + .1;
+				}
+			}
+		}
+		
+		if(it->GetSystem() != player.GetSystem())
+			continue;
+		
+		// Each ship only switches targets twice a second, so that it can
+		// focus on damaging one particular ship.
+		const Ship *target = it->TargetShip();
+		targetTurn = (targetTurn + 1) & 31;
+		decisions.emplace_back();
+		Decision &decision = decisions.back();
+		decision.ship = it.get();
+		decision.findTarget = (targetTurn == step || !target || !target->IsTargetable() || target->IsDestroyed()
+			|| (target->IsDisabled() && personality.Disables()));
+		decision.opportunistic = (it->IsYours() ? opportunisticEscorts : personality.IsOpportunistic());
+	}
+	
+	// Picking targets and aiming and firing weapons is the most expensive part
+	// of the AI, and each ship's decision only reads the state of the other
+	// ships, so it is done in parallel. Nothing is changed until every ship's
+	// decision has been made. Each block of ships gets its own random seed, so
+	// the results do not depend on how many threads there are.
+	WorkerPool::RunSeeded(decisions.size(), DECISION_BLOCK, [this, &decisions](int start, int end)
+	{
+		for(int i = start; i < end; ++i)
+		{
+			Decision &decision = decisions[i];
+			const Ship &ship = *decision.ship;
+			decision.target = decision.findTarget ? FindTarget(ship) : ship.GetTargetShip();
+			AimTurrets(ship, decision.target.get(), decision.command, decision.opportunistic);
+			AutoFire(ship, decision.target, decision.command);
+		}
+	});
+	
+	auto decision = decisions.begin();
 	for(const auto &it : ships)
 	{
 		// Skip any carried fighters or drones that are somehow in the list.
@@ -346,17 +493,25 @@ void AI::Step(const PlayerInfo &player)
 				if(!it->IsYours() || thisIsLaunching)
 					it->SetCommands(Command::DEPLOY);
 				// Avoid jettisoning cargo as soon as this ship is repaired.
-				double &threshold = appeasmentThreshold[it.get()];
+				double &threshold = State(*it).appeasementThreshold;
 				threshold = max((1. - health) + .1, threshold);
 				continue;
 			}
 		}
 		// Special case: if the player's flagship tries to board a ship to
 		// refuel it, that escort should hold position for boarding.
-		isStranded |= (flagship && it == flagship->GetTargetShip() && CanBoard(*flagship, *it)
+		isStranded |= (flagship && it.get() == flagship->TargetShip() && CanBoard(*flagship, *it)
 			&& keyStuck.Has(Command::BOARD));
 		
+		// Apply the target and weapons commands that were picked above.
 		Command command;
+		if(decision != decisions.end() && decision->ship == it.get())
+		{
+			if(decision->findTarget)
+				it->SetTargetShip(decision->target);
+			command = decision->command;
+			++decision;
+		}
 		if(it->IsYours())
 		{
 			if(thisIsLaunching)
@@ -364,59 +519,7 @@ void AI::Step(const PlayerInfo &player)
 			if(isCloaking)
 				command |= Command::CLOAK;
 		}
-		
-		// If your parent is destroyed, you are no longer an escort.
 		shared_ptr<Ship> parent = it->GetParent();
-		if(parent && parent->IsDestroyed())
-		{
-			parent.reset();
-			it->SetParent(parent);
-		}
-		
-		// Special actions when a ship is near death:
-		if(health < 1.)
-		{
-			if(parent && personality.IsCoward())
-			{
-				// Cowards abandon their fleets.
-				parent.reset();
-				it->SetParent(parent);
-			}
-			if(personality.IsAppeasing() && it->Cargo().Used())
-			{
-				double &threshold = appeasmentThreshold[it.get()];
-				if(1. - health > threshold)
-				{
-					// "Appeasing" ships will dump some fraction of their cargo.
-					int toDump = 11 + (1. - health) * .5 * it->Cargo().Size();
-					for(const auto &commodity : it->Cargo().Commodities())
-					{
-						it->Jettison(commodity.first, min(commodity.second, toDump));
-						toDump -= commodity.second;
-						if(toDump <= 0)
-							break;
-					}
-					Messages::Add(it->GetGovernment()->GetName() + " ship \"" + it->Name()
-						+ "\": Please, just take my cargo and leave me alone.");
-					threshold = (1. - health) + .1;
-				}
-			}
-		}
-		
-		// Pick a target and automatically fire weapons.
-		shared_ptr<const Ship> target = it->GetTargetShip();
-		if(isPresent)
-		{
-			// Each ship only switches targets twice a second, so that it can
-			// focus on damaging one particular ship.
-			targetTurn = (targetTurn + 1) & 31;
-			if(targetTurn == step || !target || !target->IsTargetable() || target->IsDestroyed()
-					|| (target->IsDisabled() && personality.Disables()))
-				it->SetTargetShip(FindTarget(*it));
-			
-			AimTurrets(*it, command, it->IsYours() ? opportunisticEscorts : personality.IsOpportunistic());
-			AutoFire(*it, command);
-		}
 		
 		// If recruited to assist a ship, follow through on the commitment
 		// instead of ignoring it due to other personality traits.
@@ -446,7 +549,7 @@ void AI::Step(const PlayerInfo &player)
 		}
 		
 		double targetDistance = numeric_limits<double>::infinity();
-		target = it->GetTargetShip();
+		const Ship *target = it->TargetShip();
 		if(target)
 			targetDistance = target->Position().Distance(it->Position());
 		
@@ -460,9 +563,9 @@ void AI::Step(const PlayerInfo &player)
 			{
 				if(target)
 				{
-					auto sit = swarmCount.find(target.get());
-					if(sit != swarmCount.end() && sit->second > 0)
-						--sit->second;
+					int &count = State(*target).swarmCount;
+					if(count > 0)
+						--count;
 					it->SetTargetShip(shared_ptr<Ship>());
 				}
 				int lowestCount = 7;
@@ -471,16 +574,16 @@ void AI::Step(const PlayerInfo &player)
 							&& other->GetSystem() == it->GetSystem() && other->IsTargetable()
 							&& !other->IsHyperspacing())
 					{
-						int count = swarmCount[other.get()] + Random::Int(4);
+						int count = State(*other).swarmCount + Random::Int(4);
 						if(count < lowestCount)
 						{
 							it->SetTargetShip(other);
 							lowestCount = count;
 						}
 					}
-				target = it->GetTargetShip();
+				target = it->TargetShip();
 				if(target)
-					++swarmCount[target.get()];
+					++State(*target).swarmCount;
 			}
 			if(target)
 				Swarm(*it, command, *target);
@@ -505,7 +608,7 @@ void AI::Step(const PlayerInfo &player)
 		}
 		
 		if(isPresent && personality.IsMining() && !target && !isStranded
-				&& it->Cargo().Free() >= 5 && ++miningTime[&*it] < 3600 && ++minerCount < 9)
+				&& it->Cargo().Free() >= 5 && ++State(*it).miningTime < 3600 && ++minerCount < 9)
 		{
 			if(it->HasBays())
 				command |= Command::DEPLOY;
@@ -513,7 +616,7 @@ void AI::Step(const PlayerInfo &player)
 			it->SetCommands(command);
 			continue;
 		}
-		else if(isPresent && !target && it->CanBeCarried() && parent && miningTime[&*parent] < 3601 && !isStranded
+		else if(isPresent && !target && it->CanBeCarried() && parent && State(*parent).miningTime < 3601 && !isStranded
 				&& parent->GetTargetAsteroid() && parent->GetTargetAsteroid()->Position().Distance(parent->Position()) < 800.)
 		{
 			// Assist your parent in mining its nearby targeted asteroid.
@@ -568,9 +671,9 @@ void AI::Step(const PlayerInfo &player)
 		}
 		bool mustRecall = false;
 		if(it->HasBays() && !(it->IsYours() ? thisIsLaunching : it->Commands().Has(Command::DEPLOY)) && !target)
-			for(const weak_ptr<Ship> &ptr : it->GetEscorts())
+			for(const ShipHandle &handle : it->GetEscorts())
 			{
-				shared_ptr<const Ship> escort = ptr.lock();
+				const Ship *escort = handle.Get();
 				if(escort && escort->CanBeCarried() && escort->GetSystem() == it->GetSystem()
 						&& !escort->IsDisabled())
 				{
@@ -607,7 +710,7 @@ void AI::Step(const PlayerInfo &player)
 			MoveIndependent(*it, command);
 		else if(parent->GetSystem() != it->GetSystem())
 		{
-			if(personality.IsStaying() || !it->Attributes().Get("fuel capacity"))
+			if(personality.IsStaying() || !it->Attributes().Get(FUEL_CAPACITY))
 				MoveIndependent(*it, command);
 			else
 				MoveEscort(*it, command);
@@ -716,7 +819,7 @@ void AI::AskForHelp(Ship &ship, bool &isStranded, const Ship *flagship)
 		{
 			Ship *helper = canHelp[Random::Int(canHelp.size())];
 			helper->SetShipToAssist((&ship)->shared_from_this());
-			helperList[&ship] = helper->shared_from_this();
+			State(ship).helper = ShipHandle(helper);
 			isStranded = true;
 		}
 		else
@@ -753,14 +856,12 @@ bool AI::CanHelp(const Ship &ship, const Ship &helper, const bool needsFuel)
 bool AI::HasHelper(const Ship &ship, const bool needsFuel)
 {
 	// Do we have an existing ship that was asked to assist?
-	if(helperList.find(&ship) != helperList.end())
-	{
-		shared_ptr<Ship> helper = helperList[&ship].lock();
-		if(helper && helper->GetShipToAssist().get() == &ship && CanHelp(ship, *helper, needsFuel))
-			return true;
-		else
-			helperList.erase(&ship);
-	}
+	ShipState &state = State(ship);
+	const Ship *helper = state.helper.Get();
+	if(helper && helper->ShipToAssist() == &ship && CanHelp(ship, *helper, needsFuel))
+		return true;
+	
+	state.helper = ShipHandle();
 	
 	return false;
 }
@@ -797,18 +898,19 @@ shared_ptr<Ship> AI::FindTarget(const Ship &ship) const
 		return target;
 	
 	const Personality &person = ship.GetPersonality();
-	shared_ptr<Ship> oldTarget = ship.GetTargetShip();
+	const Ship *oldTarget = ship.TargetShip();
 	if(oldTarget && !oldTarget->IsTargetable())
-		oldTarget.reset();
+		oldTarget = nullptr;
 	if(oldTarget && person.IsTimid() && oldTarget->IsDisabled()
 			&& ship.Position().Distance(oldTarget->Position()) > 1000.)
-		oldTarget.reset();
-	shared_ptr<Ship> parentTarget;
-	bool parentIsEnemy = (ship.GetParent() && ship.GetParent()->GetGovernment()->IsEnemy(gov));
-	if(ship.GetParent() && !parentIsEnemy)
-		parentTarget = ship.GetParent()->GetTargetShip();
+		oldTarget = nullptr;
+	const Ship *parent = ship.Parent();
+	const Ship *parentTarget = nullptr;
+	bool parentIsEnemy = (parent && parent->GetGovernment()->IsEnemy(gov));
+	if(parent && !parentIsEnemy)
+		parentTarget = parent->TargetShip();
 	if(parentTarget && !parentTarget->IsTargetable())
-		parentTarget.reset();
+		parentTarget = nullptr;
 
 	// Find the closest enemy ship (if there is one). If this ship is "heroic,"
 	// it will attack any ship in system. Otherwise, if all its weapons have a
@@ -822,10 +924,25 @@ shared_ptr<Ship> AI::FindTarget(const Ship &ship) const
 	bool hasNemesis = false;
 	// Figure out how strong this ship is.
 	int64_t maxStrength = 0;
-	auto strengthIt = shipStrength.find(&ship);
-	if(!person.IsHeroic() && strengthIt != shipStrength.end())
-		maxStrength = 2 * strengthIt->second;
-	for(const auto &it : ships)
+	const ShipState *state = FindState(ship);
+	if(!person.IsHeroic() && state)
+		maxStrength = 2 * state->strength;
+	// Heroic and nemesis ships may choose targets anywhere in the system, so
+	// they check every enemy. Any other ship can only choose a target whose
+	// range is less than "closest." That range is measured from where both
+	// ships will be in a second, and may be reduced by 500, so search a bit
+	// farther out than that.
+	const vector<int> *candidates = &nearbyShips;
+	if(person.IsHeroic() || person.IsNemesis())
+		candidates = &enemyIndex[gov->Index()];
+	else
+	{
+		double radius = closest + 500. + 60. * (ship.Velocity().Length() + maxShipSpeed) + 1.;
+		ShipsInRange(ship.Position(), radius, nearbyShips);
+	}
+	for(int i : *candidates)
+	{
+		Ship *it = shipIndex[i];
 		if(it->GetSystem() == system && it->IsTargetable() && gov->IsEnemy(it->GetGovernment()))
 		{
 			// If this is a "nemesis" ship and it has found one of the player's
@@ -842,8 +959,8 @@ shared_ptr<Ship> AI::FindTarget(const Ship &ship) const
 			if(!person.IsUnconstrained())
 			{
 				// Makes sure this ship isn't parked outside the invisible fence.
-				auto fit = fenceCount.find(&*it);
-				if(fit != fenceCount.end() && fit->second == FENCE_MAX)
+				const ShipState *otherState = FindState(*it);
+				if(otherState && otherState->fenceCount == FENCE_MAX)
 					continue;
 			}
 			
@@ -860,8 +977,8 @@ shared_ptr<Ship> AI::FindTarget(const Ship &ship) const
 			// unless it has strong allies nearby.
 			if(maxStrength && range > 1000. && !it->IsDisabled())
 			{
-				auto otherStrengthIt = shipStrength.find(it.get());
-				if(otherStrengthIt != shipStrength.end() && otherStrengthIt->second > maxStrength)
+				const ShipState *otherState = FindState(*it);
+				if(otherState && otherState->strength > maxStrength)
 					continue;
 			}
 			
@@ -875,7 +992,7 @@ shared_ptr<Ship> AI::FindTarget(const Ship &ship) const
 				range += 5000. * it->IsDisabled();
 			else
 			{
-				bool hasBoarded = Has(ship, it, ShipEvent::BOARD) || !ship.Cargo().Free();
+				bool hasBoarded = Has(ship, *it, ShipEvent::BOARD) || !ship.Cargo().Free();
 				// Don't plunder unless there are no "live" enemies nearby.
 				range += 2000. * (2 * it->IsDisabled() - !hasBoarded);
 			}
@@ -894,22 +1011,23 @@ shared_ptr<Ship> AI::FindTarget(const Ship &ship) const
 			if((isPotentialNemesis && !hasNemesis) || range < closest)
 			{
 				closest = range;
-				target = it;
+				target = it->shared_from_this();
 				isDisabled = it->IsDisabled();
 				hasNemesis = isPotentialNemesis;
 			}
 		}
+	}
 	
-	bool cargoScan = ship.Attributes().Get("cargo scan") || ship.Attributes().Get("cargo scan power");
-	bool outfitScan = ship.Attributes().Get("outfit scan") || ship.Attributes().Get("outfit scan power");
+	bool cargoScan = ship.Attributes().Get(CARGO_SCAN) || ship.Attributes().Get(CARGO_SCAN_POWER);
+	bool outfitScan = ship.Attributes().Get(OUTFIT_SCAN) || ship.Attributes().Get(OUTFIT_SCAN_POWER);
 	if(!target && (cargoScan || outfitScan) && !isPlayerEscort)
 	{
 		closest = numeric_limits<double>::infinity();
 		for(const auto &it : ships)
 			if(it->GetSystem() == system && it->GetGovernment() != gov && it->IsTargetable())
 			{
-				if((cargoScan && !Has(ship.GetGovernment(), it, ShipEvent::SCAN_CARGO))
-						|| (outfitScan && !Has(ship.GetGovernment(), it, ShipEvent::SCAN_OUTFITS)))
+				if((cargoScan && !Has(ship.GetGovernment(), *it, ShipEvent::SCAN_CARGO))
+						|| (outfitScan && !Has(ship.GetGovernment(), *it, ShipEvent::SCAN_OUTFITS)))
 				{
 					double range = it->Position().Distance(ship.Position());
 					if(range < closest)
@@ -928,7 +1046,7 @@ shared_ptr<Ship> AI::FindTarget(const Ship &ship) const
 	{
 		// Make sure the ship has somewhere to flee to.
 		const System *system = ship.GetSystem();
-		if(ship.JumpsRemaining() && (!system->Links().empty() || ship.Attributes().Get("jump drive")))
+		if(ship.JumpsRemaining() && (!system->Links().empty() || ship.Attributes().Get(JUMP_DRIVE)))
 			target.reset();
 		else
 			for(const StellarObject &object : system->Objects())
@@ -974,8 +1092,8 @@ bool AI::FollowOrders(Ship &ship, Command &command) const
 	if(type == Orders::MOVE_TO && it->second.targetSystem && ship.GetSystem() != it->second.targetSystem)
 	{
 		// The desired position is in a different system.
-		DistanceMap distance(ship, it->second.targetSystem);
-		const System *to = distance.Route(ship.GetSystem());
+		shared_ptr<const DistanceMap> distance = DistanceMap::Cached(ship, it->second.targetSystem);
+		const System *to = distance->Route(ship.GetSystem());
 		ship.SetTargetSystem(to);
 		return false;
 	}
@@ -1030,7 +1148,7 @@ void AI::MoveIndependent(Ship &ship, Command &command) const
 	if(target && (ship.GetGovernment()->IsEnemy(target->GetGovernment()) || friendlyOverride))
 	{
 		bool shouldBoard = ship.Cargo().Free() && ship.GetPersonality().Plunders();
-		bool hasBoarded = Has(ship, target, ShipEvent::BOARD);
+		bool hasBoarded = Has(ship, *target, ShipEvent::BOARD);
 		if(shouldBoard && target->IsDisabled() && !hasBoarded)
 		{
 			if(ship.IsBoarding())
@@ -1044,10 +1162,10 @@ void AI::MoveIndependent(Ship &ship, Command &command) const
 	}
 	else if(target)
 	{
-		bool cargoScan = ship.Attributes().Get("cargo scan") || ship.Attributes().Get("cargo scan power");
-		bool outfitScan = ship.Attributes().Get("outfit scan") || ship.Attributes().Get("outfit scan power");
-		if((!cargoScan || Has(ship.GetGovernment(), target, ShipEvent::SCAN_CARGO))
-				&& (!outfitScan || Has(ship.GetGovernment(), target, ShipEvent::SCAN_OUTFITS)))
+		bool cargoScan = ship.Attributes().Get(CARGO_SCAN) || ship.Attributes().Get(CARGO_SCAN_POWER);
+		bool outfitScan = ship.Attributes().Get(OUTFIT_SCAN) || ship.Attributes().Get(OUTFIT_SCAN_POWER);
+		if((!cargoScan || Has(ship.GetGovernment(), *target, ShipEvent::SCAN_CARGO))
+				&& (!outfitScan || Has(ship.GetGovernment(), *target, ShipEvent::SCAN_OUTFITS)))
 			target.reset();
 		else
 		{
@@ -1059,7 +1177,7 @@ void AI::MoveIndependent(Ship &ship, Command &command) const
 	}
 	
 	const bool shouldStay = ship.GetPersonality().IsStaying()
-			||  (ship.GetParent() && ship.GetParent()->GetGovernment()->IsEnemy(ship.GetGovernment()));
+			||  (ship.Parent() && ship.Parent()->GetGovernment()->IsEnemy(ship.GetGovernment()));
 	if(!ship.GetTargetSystem() && !ship.GetTargetStellar() && !shouldStay)
 	{
 		int jumps = ship.JumpsRemaining();
@@ -1069,7 +1187,7 @@ void AI::MoveIndependent(Ship &ship, Command &command) const
 		
 		vector<int> systemWeights;
 		int totalWeight = 0;
-		const set<const System *> &links = ship.Attributes().Get("jump drive")
+		const set<const System *> &links = ship.Attributes().Get(JUMP_DRIVE)
 			? ship.GetSystem()->Neighbors() : ship.GetSystem()->Links();
 		if(jumps)
 		{
@@ -1141,10 +1259,10 @@ void AI::MoveIndependent(Ship &ship, Command &command) const
 		PrepareForHyperspace(ship, command);
 		bool mustWait = false;
 		if(ship.BaysFree(false) || ship.BaysFree(true))
-			for(const weak_ptr<Ship> &escort : ship.GetEscorts())
+			for(const ShipHandle &handle : ship.GetEscorts())
 			{
-				shared_ptr<const Ship> locked = escort.lock();
-				mustWait |= locked && locked->CanBeCarried() && !locked->IsDisabled();
+				const Ship *escort = handle.Get();
+				mustWait |= escort && escort->CanBeCarried() && !escort->IsDisabled();
 			}
 		
 		if(!mustWait)
@@ -1153,7 +1271,7 @@ void AI::MoveIndependent(Ship &ship, Command &command) const
 	else if(ship.GetTargetStellar())
 	{
 		MoveToPlanet(ship, command);
-		if(!shouldStay && ship.Attributes().Get("fuel capacity")
+		if(!shouldStay && ship.Attributes().Get(FUEL_CAPACITY)
 				&& ship.GetTargetStellar()->GetPlanet() && ship.GetTargetStellar()->GetPlanet()->CanLand(ship))
 			command |= Command::LAND;
 		else if(ship.Position().Distance(ship.GetTargetStellar()->Position()) < 100.)
@@ -1170,8 +1288,8 @@ void AI::MoveIndependent(Ship &ship, Command &command) const
 
 void AI::MoveEscort(Ship &ship, Command &command) const
 {
-	const Ship &parent = *ship.GetParent();
-	bool hasFuelCapacity = ship.Attributes().Get("fuel capacity") && ship.JumpFuel();
+	const Ship &parent = *ship.Parent();
+	bool hasFuelCapacity = ship.Attributes().Get(FUEL_CAPACITY) && ship.JumpFuel();
 	bool isStaying = ship.GetPersonality().IsStaying() || !hasFuelCapacity;
 	bool parentIsHere = (ship.GetSystem() == parent.GetSystem());
 	// Check if the parent has a target planet that is in the parent's system.
@@ -1200,9 +1318,9 @@ void AI::MoveEscort(Ship &ship, Command &command) const
 		{
 			// If we're stranded and haven't decided where to go, figure out a
 			// path to the parent ship's system.
-			DistanceMap distance(ship, parent.GetSystem());
+			shared_ptr<const DistanceMap> distance = DistanceMap::Cached(ship, parent.GetSystem());
 			const System *from = ship.GetSystem();
-			const System *to = distance.Route(from);
+			const System *to = distance->Route(from);
 			for(const StellarObject &object : from->Objects())
 				if(object.GetPlanet() && object.GetPlanet()->WormholeDestination(from) == to)
 				{
@@ -1244,12 +1362,12 @@ void AI::MoveEscort(Ship &ship, Command &command) const
 		if(parent.IsLanding() || parent.CanLand())
 			command |= Command::LAND;
 	}
-	else if(parent.Commands().Has(Command::BOARD) && parent.GetTargetShip().get() == &ship)
+	else if(parent.Commands().Has(Command::BOARD) && parent.TargetShip() == &ship)
 		Stop(ship, command, .2);
 	else if(parent.Commands().Has(Command::JUMP) && parent.GetTargetSystem() && !isStaying)
 	{
-		DistanceMap distance(ship, parent.GetTargetSystem());
-		const System *dest = distance.Route(ship.GetSystem());
+		shared_ptr<const DistanceMap> distance = DistanceMap::Cached(ship, parent.GetTargetSystem());
+		const System *dest = distance->Route(ship.GetSystem());
 		ship.SetTargetSystem(dest);
 		if(!dest)
 			// This ship has no route to the parent's destination system, so protect it until it jumps away.
@@ -1273,7 +1391,7 @@ void AI::MoveEscort(Ship &ship, Command &command) const
 
 void AI::Refuel(Ship &ship, Command &command)
 {
-	const StellarObject *parentTarget = (ship.GetParent() ? ship.GetParent()->GetTargetStellar() : nullptr);
+	const StellarObject *parentTarget = (ship.Parent() ? ship.Parent()->GetTargetStellar() : nullptr);
 	if(CanRefuel(ship, parentTarget))
 		ship.SetTargetStellar(parentTarget);
 	else if(!CanRefuel(ship, ship.GetTargetStellar()))
@@ -1408,7 +1526,7 @@ bool AI::Stop(Ship &ship, Command &command, double maxSpeed, const Point directi
 	
 	// If you have a reverse thruster, figure out whether using it is faster
 	// than turning around and using your main thruster.
-	if(ship.Attributes().Get("reverse thrust"))
+	if(ship.Attributes().Get(REVERSE_THRUST))
 	{
 		// Figure out your stopping time using your main engine:
 		double degreesToTurn = TO_DEG * acos(min(1., max(-1., -velocity.Unit().Dot(angle.Unit()))));
@@ -1416,7 +1534,7 @@ bool AI::Stop(Ship &ship, Command &command, double maxSpeed, const Point directi
 		forwardTime += stopTime;
 		
 		// Figure out your reverse thruster stopping time:
-		double reverseAcceleration = ship.Attributes().Get("reverse thrust") / ship.Mass();
+		double reverseAcceleration = ship.Attributes().Get(REVERSE_THRUST) / ship.Mass();
 		double reverseTime = (180. - degreesToTurn) / ship.TurnRate();
 		reverseTime += speed / reverseAcceleration;
 		
@@ -1454,9 +1572,9 @@ bool AI::Stop(Ship &ship, Command &command, double maxSpeed, const Point directi
 
 void AI::PrepareForHyperspace(Ship &ship, Command &command)
 {
-	bool hasHyperdrive = ship.Attributes().Get("hyperdrive");
-	double scramThreshold = ship.Attributes().Get("scram drive");
-	bool hasJumpDrive = ship.Attributes().Get("jump drive");
+	bool hasHyperdrive = ship.Attributes().Get(HYPERDRIVE);
+	double scramThreshold = ship.Attributes().Get(SCRAM_DRIVE);
+	bool hasJumpDrive = ship.Attributes().Get(JUMP_DRIVE);
 	if(!hasHyperdrive && !hasJumpDrive)
 		return;
 	
@@ -1496,9 +1614,9 @@ void AI::PrepareForHyperspace(Ship &ship, Command &command)
 	}
 	// If we're a jump drive, just stop.
 	else if(isJump)
-		Stop(ship, command, ship.Attributes().Get("jump speed"));
+		Stop(ship, command, ship.Attributes().Get(JUMP_SPEED));
 	// Else stop in the fastest way to end facing in the right direction
-	else if(Stop(ship, command, ship.Attributes().Get("jump speed"), direction))
+	else if(Stop(ship, command, ship.Attributes().Get(JUMP_SPEED), direction))
 		command.SetTurn(TurnToward(ship, direction));
 }
 
@@ -1590,12 +1708,12 @@ void AI::KeepStation(Ship &ship, Command &command, const Ship &target)
 		command.SetTurn(targetAngle < 0. ? -1. : 1.);
 	
 	// Determine whether to apply thrust.
-	Point drag = ship.Velocity() * (ship.Attributes().Get("drag") / mass);
-	if(ship.Attributes().Get("reverse thrust"))
+	Point drag = ship.Velocity() * (ship.Attributes().Get(DRAG) / mass);
+	if(ship.Attributes().Get(REVERSE_THRUST))
 	{
 		// Don't take drag into account when reverse thrusting, because this
 		// estimate of how it will be applied can be quite inaccurate.
-		Point a = (unit * (-ship.Attributes().Get("reverse thrust") / mass)).Unit();
+		Point a = (unit * (-ship.Attributes().Get(REVERSE_THRUST) / mass)).Unit();
 		double direction = positionWeight * positionDelta.Dot(a) / POSITION_DEADBAND
 			+ velocityWeight * velocityDelta.Dot(a) / VELOCITY_DEADBAND;
 		if(direction > THRUST_DEADBAND)
@@ -1718,18 +1836,18 @@ void AI::PickUp(Ship &ship, Command &command, const Body &target)
 // energy strain, or undue thermal loads if almost overheated.
 bool AI::ShouldUseAfterburner(Ship &ship)
 {
-	if(!ship.Attributes().Get("afterburner thrust"))
+	if(!ship.Attributes().Get(AFTERBURNER_THRUST))
 		return false;
 	
-	double fuel = ship.Fuel() * ship.Attributes().Get("fuel capacity");
-	double neededFuel = ship.Attributes().Get("afterburner fuel");
-	double energy = ship.Energy() * ship.Attributes().Get("energy capacity");
-	double neededEnergy = ship.Attributes().Get("afterburner energy");
+	double fuel = ship.Fuel() * ship.Attributes().Get(FUEL_CAPACITY);
+	double neededFuel = ship.Attributes().Get(AFTERBURNER_FUEL);
+	double energy = ship.Energy() * ship.Attributes().Get(ENERGY_CAPACITY);
+	double neededEnergy = ship.Attributes().Get(AFTERBURNER_ENERGY);
 	if(energy == 0.)
-		energy = ship.Attributes().Get("energy generation")
-				+ 0.2 * ship.Attributes().Get("solar collection")
-				- ship.Attributes().Get("energy consumption");
-	double outputHeat = ship.Attributes().Get("afterburner heat") / (100 * ship.Mass());
+		energy = ship.Attributes().Get(ENERGY_GENERATION)
+				+ 0.2 * ship.Attributes().Get(SOLAR_COLLECTION)
+				- ship.Attributes().Get(ENERGY_CONSUMPTION);
+	double outputHeat = ship.Attributes().Get(AFTERBURNER_HEAT) / (100 * ship.Mass());
 	if((!neededFuel || fuel - neededFuel > ship.JumpFuel())
 			&& (!neededEnergy || neededEnergy / energy < 0.25)
 			&& (!outputHeat || ship.Heat() + outputHeat < .9))
@@ -1757,11 +1875,11 @@ void AI::DoSurveillance(Ship &ship, Command &command) const
 		return;
 	}
 	
-	bool cargoScan = ship.Attributes().Get("cargo scan") || ship.Attributes().Get("cargo scan power");
-	bool outfitScan = ship.Attributes().Get("outfit scan") || ship.Attributes().Get("outfit scan power");
-	double atmosphereScan = ship.Attributes().Get("atmosphere scan");
-	bool jumpDrive = ship.Attributes().Get("jump drive");
-	bool hyperdrive = ship.Attributes().Get("hyperdrive");
+	bool cargoScan = ship.Attributes().Get(CARGO_SCAN) || ship.Attributes().Get(CARGO_SCAN_POWER);
+	bool outfitScan = ship.Attributes().Get(OUTFIT_SCAN) || ship.Attributes().Get(OUTFIT_SCAN_POWER);
+	double atmosphereScan = ship.Attributes().Get(ATMOSPHERE_SCAN);
+	bool jumpDrive = ship.Attributes().Get(JUMP_DRIVE);
+	bool hyperdrive = ship.Attributes().Get(HYPERDRIVE);
 	
 	// This function is only called for ships that are in the player's system.
 	if(ship.GetTargetSystem())
@@ -1782,8 +1900,8 @@ void AI::DoSurveillance(Ship &ship, Command &command) const
 	else if(target)
 	{
 		// If the pointer to the target ship exists, it is targetable and in-system.
-		bool mustScanCargo = cargoScan && !Has(ship, target, ShipEvent::SCAN_CARGO);
-		bool mustScanOutfits = outfitScan && !Has(ship, target, ShipEvent::SCAN_OUTFITS);
+		bool mustScanCargo = cargoScan && !Has(ship, *target, ShipEvent::SCAN_CARGO);
+		bool mustScanOutfits = outfitScan && !Has(ship, *target, ShipEvent::SCAN_OUTFITS);
 		if(!mustScanCargo && !mustScanOutfits)
 			ship.SetTargetShip(shared_ptr<Ship>());
 		else
@@ -1810,8 +1928,8 @@ void AI::DoSurveillance(Ship &ship, Command &command) const
 				if(it->GetGovernment() != ship.GetGovernment() && it->IsTargetable()
 						&& it->GetSystem() == ship.GetSystem())
 				{
-					if((!cargoScan || Has(ship, it, ShipEvent::SCAN_CARGO))
-							&& (!outfitScan || Has(ship, it, ShipEvent::SCAN_OUTFITS)))
+					if((!cargoScan || Has(ship, *it, ShipEvent::SCAN_CARGO))
+							&& (!outfitScan || Has(ship, *it, ShipEvent::SCAN_OUTFITS)))
 						continue;
 					
 					targetShips.push_back(it);
@@ -1858,18 +1976,24 @@ void AI::DoMining(Ship &ship, Command &command)
 {
 	// This function is only called for ships that are in the player's system.
 	// Update the radius that the ship is searching for asteroids at.
-	bool isNew = !miningAngle.count(&ship);
-	Angle &angle = miningAngle[&ship];
-	if(isNew)
+	ShipState &state = State(ship);
+	Angle &angle = state.miningAngle;
+	if(!state.hasMiningAngle)
+	{
 		angle = Angle::Random();
+		state.hasMiningAngle = true;
+	}
 	angle += Angle::Random(1.) - Angle::Random(1.);
 	double miningRadius = ship.GetSystem()->AsteroidBelt() * pow(2., angle.Unit().X());
 	
 	shared_ptr<Minable> target = ship.GetTargetAsteroid();
 	if(!target)
 	{
-		for(const shared_ptr<Minable> &minable : minables)
+		const vector<shared_ptr<Minable>> &minables = asteroids.Minables();
+		asteroids.MinablesInRange(ship.Position(), 800., nearbyMinables);
+		for(int i : nearbyMinables)
 		{
+			const shared_ptr<Minable> &minable = minables[i];
 			Point offset = minable->Position() - ship.Position();
 			if(offset.Length() < 800. && offset.Unit().Dot(ship.Facing().Unit()) > .7)
 			{
@@ -1947,13 +2071,13 @@ bool AI::DoHarvesting(Ship &ship, Command &command)
 
 void AI::DoCloak(Ship &ship, Command &command)
 {
-	if(ship.Attributes().Get("cloak"))
+	if(ship.Attributes().Get(CLOAK))
 	{
 		// Never cloak if it will cause you to be stranded.
-		if(ship.Attributes().Get("cloaking fuel") && !ship.Attributes().Get("ramscoop"))
+		if(ship.Attributes().Get(CLOAKING_FUEL) && !ship.Attributes().Get(RAMSCOOP))
 		{
-			double fuel = ship.Fuel() * ship.Attributes().Get("fuel capacity");
-			fuel -= ship.Attributes().Get("cloaking fuel");
+			double fuel = ship.Fuel() * ship.Attributes().Get(FUEL_CAPACITY);
+			fuel -= ship.Attributes().Get(CLOAKING_FUEL);
 			if(fuel < ship.JumpFuel())
 				return;
 		}
@@ -1970,14 +2094,14 @@ void AI::DoCloak(Ship &ship, Command &command)
 		// If this ship has started cloaking, it must get at least 40% repaired
 		// or 40% farther away before it begins decloaking again.
 		double hysteresis = ship.Commands().Has(Command::CLOAK) ? 1.4 : 1.;
-		double cloakIsFree = !ship.Attributes().Get("cloaking fuel");
+		double cloakIsFree = !ship.Attributes().Get(CLOAKING_FUEL);
 		if(ship.Hull() + .5 * ship.Shields() < hysteresis
 				&& (cloakIsFree || nearestEnemy < 2000. * hysteresis))
 			command |= Command::CLOAK;
 		
 		// Also cloak if there are no enemies nearby and cloaking does
 		// not cost you fuel.
-		if(nearestEnemy == MAX_RANGE && cloakIsFree && !ship.GetTargetShip())
+		if(nearestEnemy == MAX_RANGE && cloakIsFree && !ship.TargetShip())
 			command |= Command::CLOAK;
 	}
 }
@@ -2037,10 +2161,10 @@ Point AI::StoppingPoint(const Ship &ship, const Point &targetVelocity, bool &sho
 	// The average term's value will be v / 2. So:
 	stopDistance += .5 * v * v / acceleration;
 	
-	if(ship.Attributes().Get("reverse thrust"))
+	if(ship.Attributes().Get(REVERSE_THRUST))
 	{
 		// Figure out your reverse thruster stopping distance:
-		double reverseAcceleration = ship.Attributes().Get("reverse thrust") / ship.Mass();
+		double reverseAcceleration = ship.Attributes().Get(REVERSE_THRUST) / ship.Mass();
 		double reverseDistance = v * (180. - degreesToTurn) / turnRate;
 		reverseDistance += .5 * v * v / reverseAcceleration;
 		
@@ -2062,7 +2186,7 @@ Point AI::StoppingPoint(const Ship &ship, const Point &targetVelocity, bool &sho
 // returns the direction to the target.
 Point AI::TargetAim(const Ship &ship)
 {
-	shared_ptr<const Ship> target = ship.GetTargetShip();
+	const Ship *target = ship.TargetShip();
 	return target ? TargetAim(ship, *target) : Point();
 }
 
@@ -2097,11 +2221,10 @@ Point AI::TargetAim(const Ship &ship, const Body &target)
 
 
 // Aim the given ship's turrets.
-void AI::AimTurrets(const Ship &ship, Command &command, bool opportunistic) const
+void AI::AimTurrets(const Ship &ship, const Ship *currentTarget, Command &command, bool opportunistic) const
 {
 	// First, get the set of potential targets.
 	vector<const Ship *> enemies;
-	const Ship *currentTarget = ship.GetTargetShip().get();
 	// If the ship has a target selected, that ship is always in the running as
 	// something to aim at, even if it is too far away.
 	if(currentTarget && currentTarget->IsTargetable())
@@ -2120,18 +2243,21 @@ void AI::AimTurrets(const Ship &ship, Command &command, bool opportunistic) cons
 		maxRange *= 1.5;
 		
 		// Now, find all enemy ships within that radius.
-		// TODO: This could use CollisionSet::Circle() for increased efficiency.
 		const Government *gov = ship.GetGovernment();
-		for(const shared_ptr<Ship> &target : ships)
+		ShipsInRange(ship.Position(), maxRange, nearbyShips);
+		for(int i : nearbyShips)
+		{
+			const Ship *target = shipIndex[i];
 			if(target->IsTargetable() && gov->IsEnemy(target->GetGovernment())
 					&& !(target->IsHyperspacing() && target->Velocity().Length() > 10.)
 					&& target->GetSystem() == ship.GetSystem()
 					&& target->Position().Distance(ship.Position()) < maxRange
-					&& target.get() != currentTarget
+					&& target != currentTarget
 					&& !target->IsDisabled()
 					&& (ship.IsYours() || !target->GetPersonality().IsMarked())
 					&& (target->IsYours() || !ship.GetPersonality().IsMarked()))
-				enemies.push_back(target.get());
+				enemies.push_back(target);
+		}
 	}
 	
 	// If there are no enemies to aim at, opportunistic turrets should sweep
@@ -2231,7 +2357,7 @@ void AI::AimTurrets(const Ship &ship, Command &command, bool opportunistic) cons
 
 
 // Fire whichever of the given ship's weapons can hit a hostile target.
-void AI::AutoFire(const Ship &ship, Command &command, bool secondary) const
+void AI::AutoFire(const Ship &ship, const shared_ptr<Ship> &target, Command &command, bool secondary) const
 {
 	const Personality &person = ship.GetPersonality();
 	if(person.IsPacifist())
@@ -2254,7 +2380,7 @@ void AI::AutoFire(const Ship &ship, Command &command, bool secondary) const
 	// not want to risk damaging that target. The only time a ship other than
 	// the player will target a friendly ship is if the player has asked a ship
 	// for assistance.
-	shared_ptr<Ship> currentTarget = ship.GetTargetShip();
+	shared_ptr<Ship> currentTarget = target;
 	const Government *gov = ship.GetGovernment();
 	bool friendlyOverride = false;
 	bool disabledOverride = false;
@@ -2289,18 +2415,22 @@ void AI::AutoFire(const Ship &ship, Command &command, bool secondary) const
 	maxRange *= 1.5;
 	
 	// Find all enemy ships within range of at least one weapon.
-	vector<shared_ptr<const Ship>> enemies;
+	vector<const Ship *> enemies;
 	if(currentTarget && currentTarget->IsTargetable())
-		enemies.push_back(currentTarget);
-	for(const auto &target : ships)
+		enemies.push_back(currentTarget.get());
+	ShipsInRange(ship.Position(), maxRange, nearbyShips);
+	for(int i : nearbyShips)
+	{
+		const Ship *target = shipIndex[i];
 		if(target->IsTargetable() && gov->IsEnemy(target->GetGovernment())
 				&& !(target->IsHyperspacing() && target->Velocity().Length() > 10.)
 				&& target->GetSystem() == ship.GetSystem()
 				&& target->Position().Distance(ship.Position()) < maxRange
-				&& target != currentTarget
+				&& target != currentTarget.get()
 				&& (ship.IsYours() || !target->GetPersonality().IsMarked())
 				&& (target->IsYours() || !person.IsMarked()))
 			enemies.push_back(target);
+	}
 	
 	for(const Hardpoint &weapon : ship.Weapons())
 	{
@@ -2322,7 +2452,7 @@ void AI::AutoFire(const Ship &ship, Command &command, bool secondary) const
 		// fuel that you cannot leave the system if necessary.
 		if(weapon.GetOutfit()->FiringFuel())
 		{
-			double fuel = ship.Fuel() * ship.Attributes().Get("fuel capacity");
+			double fuel = ship.Fuel() * ship.Attributes().Get(FUEL_CAPACITY);
 			fuel -= weapon.GetOutfit()->FiringFuel();
 			// If the ship is not ever leaving this system, it does not need to
 			// reserve any fuel.
@@ -2342,7 +2472,7 @@ void AI::AutoFire(const Ship &ship, Command &command, bool secondary) const
 		// Homing weapons revert to "dumb firing" if they have no target.
 		if(weapon.IsHoming() && currentTarget)
 		{
-			bool hasBoarded = Has(ship, currentTarget, ShipEvent::BOARD);
+			bool hasBoarded = Has(ship, *currentTarget, ShipEvent::BOARD);
 			if(currentTarget->IsDisabled() && spareDisabled && !hasBoarded && !disabledOverride)
 				continue;
 			// Don't fire secondary weapons at targets that have started jumping.
@@ -2373,10 +2503,10 @@ void AI::AutoFire(const Ship &ship, Command &command, bool secondary) const
 			continue;
 		}
 		// For non-homing weapons:
-		for(const shared_ptr<const Ship> &target : enemies)
+		for(const Ship *target : enemies)
 		{
 			// Don't shoot ships we want to plunder.
-			bool hasBoarded = Has(ship, target, ShipEvent::BOARD);
+			bool hasBoarded = Has(ship, *target, ShipEvent::BOARD);
 			if(target->IsDisabled() && spareDisabled && !hasBoarded && !disabledOverride)
 				continue;
 			
@@ -2772,7 +2902,7 @@ void AI::MovePlayer(Ship &ship, const PlayerInfo &player)
 		if(!ship.GetTargetSystem() && !isWormhole)
 		{
 			double bestMatch = -2.;
-			const auto &links = (ship.Attributes().Get("jump drive") ?
+			const auto &links = (ship.Attributes().Get(JUMP_DRIVE) ?
 				ship.GetSystem()->Neighbors() : ship.GetSystem()->Links());
 			for(const System *link : links)
 			{
@@ -2804,11 +2934,11 @@ void AI::MovePlayer(Ship &ship, const PlayerInfo &player)
 		command |= Command::SCAN;
 	
 	const shared_ptr<const Ship> target = ship.GetTargetShip();
-	AimTurrets(ship, command, !Preferences::Has("Turrets focus fire"));
+	AimTurrets(ship, ship.GetTargetShip().get(), command, !Preferences::Has("Turrets focus fire"));
 	if(Preferences::Has("Automatic firing") && !ship.IsBoarding()
 			&& !(keyStuck | keyHeld).Has(Command::LAND | Command::JUMP | Command::BOARD)
 			&& (!target || target->GetGovernment()->IsEnemy()))
-		AutoFire(ship, command, false);
+		AutoFire(ship, ship.GetTargetShip(), command, false);
 	if(keyHeld)
 	{
 		if(keyHeld.Has(Command::FORWARD))
@@ -2817,7 +2947,7 @@ void AI::MovePlayer(Ship &ship, const PlayerInfo &player)
 			command.SetTurn(keyHeld.Has(Command::RIGHT) - keyHeld.Has(Command::LEFT));
 		if(keyHeld.Has(Command::BACK))
 		{
-			if(!keyHeld.Has(Command::FORWARD) && ship.Attributes().Get("reverse thrust"))
+			if(!keyHeld.Has(Command::FORWARD) && ship.Attributes().Get(REVERSE_THRUST))
 				command |= Command::BACK;
 			else if(!keyHeld.Has(Command::RIGHT | Command::LEFT))
 				command.SetTurn(TurnBackward(ship));
@@ -2907,7 +3037,7 @@ void AI::MovePlayer(Ship &ship, const PlayerInfo &player)
 	}
 	else if(keyStuck.Has(Command::JUMP))
 	{
-		if(!ship.Attributes().Get("hyperdrive") && !ship.Attributes().Get("jump drive"))
+		if(!ship.Attributes().Get(HYPERDRIVE) && !ship.Attributes().Get(JUMP_DRIVE))
 		{
 			Messages::Add("You do not have a hyperdrive installed.");
 			keyStuck.Clear();
@@ -2955,32 +3085,16 @@ void AI::MovePlayer(Ship &ship, const PlayerInfo &player)
 
 
 
-bool AI::Has(const Ship &ship, const weak_ptr<const Ship> &other, int type) const
+bool AI::Has(const Ship &ship, const Ship &other, int type) const
 {
-	auto sit = actions.find(ship.shared_from_this());
-	if(sit == actions.end())
-		return false;
-	
-	auto oit = sit->second.find(other);
-	if(oit == sit->second.end())
-		return false;
-	
-	return (oit->second & type);
+	return (actions.Get(&ship, nullptr, other) & type);
 }
 
 
 
-bool AI::Has(const Government *government, const weak_ptr<const Ship> &other, int type) const
+bool AI::Has(const Government *government, const Ship &other, int type) const
 {
-	auto git = governmentActions.find(government);
-	if(git == governmentActions.end())
-		return false;
-	
-	auto oit = git->second.find(other);
-	if(oit == git->second.end())
-		return false;
-	
-	return (oit->second & type);
+	return (actions.Get(nullptr, government, other) & type);
 }
 
 
@@ -3076,3 +3190,184 @@ void AI::IssueOrders(const PlayerInfo &player, const Orders &newOrders, const st
 			orders.erase(ship);
 	}
 }
+
+
+
+// Get the state of the given ship, creating it if necessary.
+AI::ShipState &AI::State(const Ship &ship)
+{
+	ShipHandle handle(&ship);
+	// If the ship could not be given a handle, it has no slot of its own, so
+	// give it a blank state rather than some other ship's.
+	if(!handle)
+	{
+		thread_local ShipState unregistered;
+		unregistered = ShipState();
+		return unregistered;
+	}
+	uint32_t index = handle.Index();
+	if(index >= states.size())
+		states.resize(index + 1);
+	
+	// If this slot used to belong to a different ship, start over.
+	ShipState &state = states[index];
+	if(state.ship.Get() != &ship)
+	{
+		state = ShipState();
+		state.ship = handle;
+	}
+	return state;
+}
+
+
+
+// Get the state of the given ship, or null if it has none.
+const AI::ShipState *AI::FindState(const Ship &ship) const
+{
+	ShipHandle handle(&ship);
+	uint32_t index = handle.Index();
+	if(!handle || index >= states.size() || states[index].ship.Get() != &ship)
+		return nullptr;
+	
+	return &states[index];
+}
+
+
+
+// Sort the ships into the grid and the lists of enemies.
+void AI::IndexShips()
+{
+	shipIndex.clear();
+	shipGrid.Clear();
+	maxShipSpeed = 0.;
+	for(const shared_ptr<Ship> &it : ships)
+	{
+		shipIndex.push_back(it.get());
+		shipGrid.Add(*it);
+		maxShipSpeed = max(maxShipSpeed, it->Velocity().Length());
+	}
+	shipGrid.Finish();
+	
+	// Only the governments that have ships need a list of enemies.
+	for(vector<int> &list : enemyIndex)
+		list.clear();
+	vector<const Government *> governments;
+	for(const Ship *ship : shipIndex)
+	{
+		const Government *gov = ship->GetGovernment();
+		if(gov && find(governments.begin(), governments.end(), gov) == governments.end())
+			governments.push_back(gov);
+	}
+	for(const Government *gov : governments)
+	{
+		if(gov->Index() >= enemyIndex.size())
+			enemyIndex.resize(gov->Index() + 1);
+		vector<int> &list = enemyIndex[gov->Index()];
+		for(unsigned i = 0; i < shipIndex.size(); ++i)
+			if(shipIndex[i]->GetGovernment() && gov->IsEnemy(shipIndex[i]->GetGovernment()))
+				list.push_back(i);
+	}
+}
+
+
+
+// Get the indices in shipIndex of all the ships that might be within the given
+// distance of the given point, in the same order as the ship list.
+void AI::ShipsInRange(const Point &center, double radius, vector<int> &result) const
+{
+	shipGrid.Query(center, radius, result);
+	sort(result.begin(), result.end());
+}
+
+
+// Forget all actions.
+void AI::ActionTable::Clear()
+{
+	entries.clear();
+	used = 0;
+}
+
+
+
+// Record that the given actor did the given types of actions to the given
+// target, and return what it had already done.
+int AI::ActionTable::Add(const Ship *actor, const Government *government, const Ship &target, int types)
+{
+	// Keep the table no more than half full, so that lookups stay short.
+	if(2 * (used + 1) > entries.size())
+		Rebuild();
+	
+	ShipHandle actorHandle(actor);
+	ShipHandle targetHandle(&target);
+	Entry &entry = entries[Find(actorHandle.ID(), government, targetHandle.ID())];
+	if(!entry.target.ID())
+	{
+		entry.actor = actorHandle;
+		entry.government = government;
+		entry.target = targetHandle;
+		++used;
+	}
+	int previous = entry.types;
+	entry.types |= types;
+	return previous;
+}
+
+
+
+// Get the types of actions that the given actor has done to the given target.
+int AI::ActionTable::Get(const Ship *actor, const Government *government, const Ship &target) const
+{
+	if(entries.empty())
+		return 0;
+	
+	// If there is no such entry, this will be an empty one, with no types.
+	return entries[Find(ShipHandle(actor).ID(), government, ShipHandle(&target).ID())].types;
+}
+
+
+
+// Find the index of the entry with the given key, or of the empty entry where
+// it should go if it is not in the table yet.
+size_t AI::ActionTable::Find(uint64_t actor, const Government *government, uint64_t target) const
+{
+	size_t mask = entries.size() - 1;
+	size_t i = ActionHash(actor, government, target) & mask;
+	while(true)
+	{
+		const Entry &entry = entries[i];
+		if(!entry.target.ID() || (entry.target.ID() == target
+				&& entry.actor.ID() == actor && entry.government == government))
+			return i;
+		i = (i + 1) & mask;
+	}
+}
+
+
+
+// Make room for at least one more entry. Any entries for ships that no longer
+// exist can never be looked up again, so they are dropped, and then the table
+// is resized to be at most one quarter full.
+void AI::ActionTable::Rebuild()
+{
+	vector<Entry> old;
+	old.swap(entries);
+	
+	size_t live = 0;
+	for(Entry &entry : old)
+	{
+		if(entry.target && (entry.government || entry.actor))
+			++live;
+		else
+			entry.target = ShipHandle();
+	}
+	
+	size_t size = 16;
+	while(size < 4 * (live + 1))
+		size *= 2;
+	entries.assign(size, Entry());
+	used = live;
+	
+	for(const Entry &entry : old)
+		if(entry.target.ID())
+			entries[Find(entry.actor.ID(), entry.government, entry.target.ID())] = entry;
+}
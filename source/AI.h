@@ -13,15 +13,18 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef AI_H_
 #define AI_H_
 
+#include "Angle.h"
+#include "BodyGrid.h"
 #include "Command.h"
 #include "Point.h"
+#include "ShipHandle.h"
 
 #include <cstdint>
 #include <list>
 #include <map>
 #include <memory>
+#include <vector>
 
-class Angle;
 class AsteroidField;
 class Body;
 class Flotsam;
@@ -47,13 +50,13 @@ public:
 template <class Type>
 	using List = std::list<std::shared_ptr<Type>>;
 	// Constructor, giving the AI access to various object lists.
-	AI(const List<Ship> &ships, const List<Minable> &minables, const List<Flotsam> &flotsam);
+	AI(const List<Ship> &ships, const AsteroidField &asteroids, const List<Flotsam> &flotsam);
 	
 	// Fleet commands from the player.
 	void IssueShipTarget(const PlayerInfo &player, const std::shared_ptr<Ship> &target);
 	void IssueMoveTarget(const PlayerInfo &player, const Point &target, const System *moveToSystem);
 	// Commands issued via the keyboard (mostly, to the flagship).
-	void UpdateKeys(PlayerInfo &player, Command &clickCommands, bool isActive);
+	void UpdateKeys(PlayerInfo &player, const Command &keys, bool shift, Command &clickCommands, bool isActive);
 	
 	// Allow the AI to track any events it is interested in.
 	void UpdateEvents(const std::list<ShipEvent> &events);
@@ -102,11 +105,12 @@ private:
 	// returns the direction to the target.
 	static Point TargetAim(const Ship &ship);
 	static Point TargetAim(const Ship &ship, const Body &target);
-	// Aim the given ship's turrets.
-	void AimTurrets(const Ship &ship, Command &command, bool opportunistic = false) const;
-	// Fire whichever of the given ship's weapons can hit a hostile target.
-	// Return a bitmask giving the weapons to fire.
-	void AutoFire(const Ship &ship, Command &command, bool secondary = true) const;
+	// Aim the given ship's turrets at its current target, or at any other
+	// enemies in range.
+	void AimTurrets(const Ship &ship, const Ship *currentTarget, Command &command, bool opportunistic = false) const;
+	// Fire whichever of the given ship's weapons can hit its current target or
+	// any other hostile ship. Set the weapons to fire in the given command.
+	void AutoFire(const Ship &ship, const std::shared_ptr<Ship> &target, Command &command, bool secondary = true) const;
 	void AutoFire(const Ship &ship, Command &command, const Body &target) const;
 	
 	// Calculate how long it will take a projectile to reach a target given the
@@ -116,8 +120,8 @@ private:
 	
 	void MovePlayer(Ship &ship, const PlayerInfo &player);
 	
-	bool Has(const Ship &ship, const std::weak_ptr<const Ship> &other, int type) const;
-	bool Has(const Government *government, const std::weak_ptr<const Ship> &other, int type) const;
+	bool Has(const Ship &ship, const Ship &other, int type) const;
+	bool Has(const Government *government, const Ship &other, int type) const;
 	
 	
 private:
@@ -139,16 +143,94 @@ private:
 		const System * targetSystem;
 	};
 
-
+	// Everything the AI remembers about one ship from one step to the next.
+	// These are stored by the index of the ship's handle, so finding them does
+	// not require a map lookup.
+	class ShipState {
+	public:
+		// The ship this state belongs to. If that ship no longer exists, the
+		// next ship to be given the same handle index starts over.
+		ShipHandle ship;
+		// The ship that was asked to help this one, if it is stranded.
+		ShipHandle helper;
+		Angle miningAngle;
+		bool hasMiningAngle = false;
+		int miningTime = 0;
+		int swarmCount = 0;
+		int fenceCount = 0;
+		double appeasementThreshold = 0.;
+		int64_t strength = 0;
+	};
+	
+	// A record of which ShipEvent types each ship or government has done to
+	// each other ship. This is a hash table keyed by ship handles, so looking
+	// up an entry does not need to walk a tree. Entries for ships that no
+	// longer exist are dropped when the table fills up, so its size depends
+	// on how many ships exist, not on how long the battle has been going on.
+	class ActionTable {
+	public:
+		// Forget all actions.
+		void Clear();
+		// Record that the given actor did the given types of actions to the
+		// given target, and return what it had already done. The actor is
+		// either a ship or a government, and the other should be null.
+		int Add(const Ship *actor, const Government *government, const Ship &target, int types);
+		// Get the types of actions that the given actor has done to the target.
+		int Get(const Ship *actor, const Government *government, const Ship &target) const;
+	
+	private:
+		class Entry {
+		public:
+			ShipHandle actor;
+			const Government *government = nullptr;
+			// If this is a null handle, the entry is empty.
+			ShipHandle target;
+			int types = 0;
+		};
+		
+		// Find the index of the entry with the given key, or of the empty
+		// entry where it should go if it is not in the table yet.
+		size_t Find(uint64_t actor, const Government *government, uint64_t target) const;
+		// Make room for at least one more entry.
+		void Rebuild();
+	
+	private:
+		std::vector<Entry> entries;
+		size_t used = 0;
+	};
+	
+	
 private:
 	void IssueOrders(const PlayerInfo &player, const Orders &newOrders, const std::string &description);
+	// Get the state of the given ship, creating it if necessary.
+	ShipState &State(const Ship &ship);
+	// Get the state of the given ship, or null if it has none. This does not
+	// change the list of states, so it is safe to call from any thread.
+	const ShipState *FindState(const Ship &ship) const;
+	// Sort the ships into the grid and the lists of enemies, at the start of
+	// each step. Ships do not move while the AI is deciding what they do.
+	void IndexShips();
+	// Get the indices in shipIndex of all the ships that might be within the
+	// given distance of the given point, in the same order as the ship list.
+	void ShipsInRange(const Point &center, double radius, std::vector<int> &result) const;
 	
 	
 private:
 	// Data from the game engine.
 	const List<Ship> &ships;
-	const List<Minable> &minables;
+	const AsteroidField &asteroids;
 	const List<Flotsam> &flotsam;
+	// The minable asteroids near the ship that is looking for one to mine.
+	std::vector<int> nearbyMinables;
+	
+	// All the ships, in order, and a grid of where they are during this step.
+	std::vector<Ship *> shipIndex;
+	BodyGrid shipGrid;
+	// The fastest that any ship is moving during this step.
+	double maxShipSpeed = 0.;
+	// For each government (by index), the indices in shipIndex of all the
+	// ships that it is hostile to, for ships that search the whole system.
+	std::vector<std::vector<int>> enemyIndex;
 	
 	int step = 0;
 	
@@ -171,18 +253,9 @@ private:
 	std::map<const Ship *, Orders> orders;
 	
 	// Records of what various AI ships and factions have done.
-	typedef std::owner_less<std::weak_ptr<const Ship>> Comp;
-	std::map<std::weak_ptr<const Ship>, std::map<std::weak_ptr<const Ship>, int, Comp>, Comp> actions;
-	std::map<const Government *, std::map<std::weak_ptr<const Ship>, int, Comp>> governmentActions;
-	std::map<std::weak_ptr<const Ship>, int, Comp> playerActions;
-	std::map<const Ship *, std::weak_ptr<Ship>> helperList;
-	std::map<const Ship *, int> swarmCount;
-	std::map<const Ship *, int> fenceCount;
-	std::map<const Ship *, Angle> miningAngle;
-	std::map<const Ship *, int> miningTime;
-	std::map<const Ship *, double> appeasmentThreshold;
-	
-	std::map<const Ship *, int64_t> shipStrength;
+	ActionTable actions;
+	
+	std::vector<ShipState> states;
 	
 	std::map<const Government *, int64_t> enemyStrength;
 	std::map<const Government *, int64_t> allyStrength;
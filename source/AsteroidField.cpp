@@ -19,6 +19,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Random.h"
 #include "Screen.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 
@@ -26,6 +27,24 @@ using namespace std;
 
 namespace {
 	const double WRAP = 4096.;
+	
+	// The asteroid grid must exactly cover the square that the asteroids
+	// repeat in, so that wrapping the grid also wraps the asteroids.
+	const int GRID_CELL_SIZE = 256;
+	const int ASTEROID_GRID_CELLS = 16;
+	// Minable asteroids do not repeat, but may be spread over a larger area.
+	const int MINABLE_GRID_CELLS = 64;
+	
+	// Buffer for the results of a grid query, for each thread that checks for
+	// collisions.
+	thread_local vector<int> nearby;
+}
+
+
+
+AsteroidField::AsteroidField()
+	: asteroidGrid(GRID_CELL_SIZE, ASTEROID_GRID_CELLS), minableGrid(GRID_CELL_SIZE, MINABLE_GRID_CELLS)
+{
 }
 
 
@@ -35,6 +54,8 @@ void AsteroidField::Clear()
 {
 	asteroids.clear();
 	minables.clear();
+	asteroidGrid.Clear();
+	minableGrid.Clear();
 }
 
 
@@ -61,26 +82,34 @@ void AsteroidField::Add(const Minable *minable, int count, double energy, double
 		minables.emplace_back(new Minable(*minable));
 		minables.back()->Place(energy, beltRadius);
 	}
+	UpdateMinables();
 }
 
 
 
 // Move all the asteroids forward one step.
-void AsteroidField::Step(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
+void AsteroidField::Step(vector<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 {
+	asteroidGrid.Clear();
 	for(Asteroid &asteroid : asteroids)
+	{
 		asteroid.Step();
+		asteroidGrid.Add(asteroid);
+	}
+	asteroidGrid.Finish();
 	
 	// Step through the minables. Since they are destructible, we may need to
 	// remove them from the list.
-	auto it = minables.begin();
-	while(it != minables.end())
-	{
+	auto out = minables.begin();
+	for(auto it = minables.begin(); it != minables.end(); ++it)
 		if((*it)->Move(effects, flotsam))
-			++it;
-		else
-			it = minables.erase(it);
-	}
+		{
+			if(out != it)
+				*out = std::move(*it);
+			++out;
+		}
+	minables.erase(out, minables.end());
+	UpdateMinables();
 }
 
 
@@ -97,37 +126,48 @@ void AsteroidField::Draw(DrawList &draw, const Point &center, double zoom) const
 
 
 // Check if the given projectile collides with any asteroids.
-double AsteroidField::Collide(const Projectile &projectile, int step, double closestHit, Point *hitVelocity)
+double AsteroidField::Collide(const Projectile &projectile, int step, double closestHit, Point *hitVelocity, Minable **hitMinable) const
 {
+	// Anything this projectile hits must be within this distance of the middle
+	// of its path, so only the asteroids in the grid cells near there need to
+	// be checked. If two asteroids are hit at exactly the same distance, the
+	// one that comes first in the list is the one that was hit.
+	Point center = projectile.Position() + .5 * projectile.Velocity();
+	double range = .5 * projectile.Velocity().Length();
+	
 	// First, check for collisions with ordinary asteroids.
-	for(const Asteroid &asteroid : asteroids)
+	int hitIndex = -1;
+	asteroidGrid.Query(center, range, nearby);
+	for(int i : nearby)
 	{
-		double thisDistance = asteroid.Collide(projectile, step);
-		if(thisDistance < closestHit)
+		double thisDistance = asteroids[i].Collide(projectile, step);
+		if(thisDistance < closestHit || (thisDistance == closestHit && i < hitIndex))
 		{
 			closestHit = thisDistance;
+			hitIndex = i;
 			if(hitVelocity)
-				*hitVelocity = asteroid.Velocity();
+				*hitVelocity = asteroids[i].Velocity();
 		}
 	}
 	// Now, check for collisions with minable asteroids. Because this is the
 	// very last collision check to be done, if a minable asteroid is the
 	// closest hit, it really is what the projectile struck - that is, we are
 	// not going to later find a ship or something else that is closer.
-	Minable *hit = nullptr;
-	for(const shared_ptr<Minable> &minable : minables)
+	hitIndex = -1;
+	minableGrid.Query(center, range, nearby);
+	for(int i : nearby)
 	{
-		double thisDistance = minable->Collide(projectile, step);
-		if(thisDistance < closestHit)
+		double thisDistance = minables[i]->Collide(projectile, step);
+		if(thisDistance < closestHit || (thisDistance == closestHit && i < hitIndex))
 		{
 			closestHit = thisDistance;
-			hit = &*minable;
+			hitIndex = i;
 			if(hitVelocity)
-				*hitVelocity = minable->Velocity();
+				*hitVelocity = minables[i]->Velocity();
 		}
 	}
-	if(hit)
-		hit->TakeDamage(projectile);
+	if(hitMinable)
+		*hitMinable = (hitIndex >= 0 ? minables[hitIndex].get() : nullptr);
 	
 	return closestHit;
 }
@@ -135,13 +175,34 @@ double AsteroidField::Collide(const Projectile &projectile, int step, double clo
 
 
 // Get the list of mainable asteroids.
-const list<shared_ptr<Minable>> &AsteroidField::Minables() const
+const vector<shared_ptr<Minable>> &AsteroidField::Minables() const
 {
 	return minables;
 }
 
 
 
+// Get the indices in Minables() of all the minable asteroids that might be
+// within the given distance of the given point, in increasing order.
+void AsteroidField::MinablesInRange(const Point &center, double radius, vector<int> &result) const
+{
+	minableGrid.Query(center, radius, result);
+	sort(result.begin(), result.end());
+}
+
+
+
+// Sort the minable asteroids into their grid, after they have moved.
+void AsteroidField::UpdateMinables()
+{
+	minableGrid.Clear();
+	for(const shared_ptr<Minable> &minable : minables)
+		minableGrid.Add(*minable);
+	minableGrid.Finish();
+}
+
+
+
 // Construct an asteroid with the given sprite and "energy level."
 AsteroidField::Asteroid::Asteroid(const Sprite *sprite, double energy)
 {
@@ -15,6 +15,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "Angle.h"
 #include "Body.h"
+#include "BodyGrid.h"
 #include "Minable.h"
 #include "Point.h"
 
@@ -39,24 +40,31 @@ class Sprite;
 // are hit by a projectile.
 class AsteroidField {
 public:
+	AsteroidField();
+	
 	// Reset the asteroid field (typically because you entered a new system).
 	void Clear();
 	void Add(const std::string &name, int count, double energy = 1.);
 	void Add(const Minable *minable, int count, double energy = 1., double beltRadius = 1500.);
 	
 	// Move all the asteroids forward one time step.
-	void Step(std::list<Effect> &effects, std::list<std::shared_ptr<Flotsam>> &flotsam);
+	void Step(std::vector<Effect> &effects, std::list<std::shared_ptr<Flotsam>> &flotsam);
 	// Draw the asteroid field, with the field of view centered on the given point.
 	void Draw(DrawList &draw, const Point &center, double zoom) const;
 	// Check if the given projectile has hit any of the asteroids. The current
 	// time step must be given, so we know what animation frame each asteroid is
 	// on. If there is a collision the asteroid's velocity is returned so the
 	// projectile's hit effects can take it into account. The return value is
-	// how far along the projectile's path it should be clipped.
-	double Collide(const Projectile &projectile, int step, double closestHit, Point *hitVelocity = nullptr);
+	// how far along the projectile's path it should be clipped. If it hit a
+	// minable asteroid, that asteroid is returned too; it is up to the caller
+	// to damage it, so that this can be called from any thread.
+	double Collide(const Projectile &projectile, int step, double closestHit, Point *hitVelocity = nullptr, Minable **hitMinable = nullptr) const;
 	
 	// Get the list of minable asteroids.
-	const std::list<std::shared_ptr<Minable>> &Minables() const;
+	const std::vector<std::shared_ptr<Minable>> &Minables() const;
+	// Get the indices in Minables() of all the minable asteroids that might be
+	// within the given distance of the given point, in increasing order.
+	void MinablesInRange(const Point &center, double radius, std::vector<int> &result) const;
 	
 	
 private:
@@ -76,9 +84,17 @@ private:
 	};
 	
 	
+private:
+	// Sort the minable asteroids into their grid, after they have moved.
+	void UpdateMinables();
+	
+	
 private:
 	std::vector<Asteroid> asteroids;
-	std::list<std::shared_ptr<Minable>> minables;
+	std::vector<std::shared_ptr<Minable>> minables;
+	
+	BodyGrid asteroidGrid;
+	BodyGrid minableGrid;
 };
 
 
@@ -0,0 +1,217 @@
+/* Benchmark.cpp
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "Benchmark.h"
+
+#include "Angle.h"
+#include "DataNode.h"
+#include "Engine.h"
+#include "Files.h"
+#include "GameData.h"
+#include "Government.h"
+#include "Messages.h"
+#include "PlayerInfo.h"
+#include "Random.h"
+#include "Ship.h"
+#include "System.h"
+
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <memory>
+
+using namespace std;
+
+namespace {
+	// Write a string as a JSON string literal.
+	string Quote(const string &str)
+	{
+		string result = "\"";
+		for(char c : str)
+		{
+			if(c == '"' || c == '\\')
+				result += '\\';
+			result += c;
+		}
+		return result + "\"";
+	}
+	
+	// Write out the mean and maximum of the given per-step values.
+	template <class Type>
+	void WriteSummary(ostream &out, const string &key, const vector<Type> &values)
+	{
+		double sum = 0.;
+		Type largest = 0;
+		for(Type value : values)
+		{
+			sum += value;
+			largest = max(largest, value);
+		}
+		out << "\t" << Quote(key) << ": {\"mean\": " << (values.empty() ? 0. : sum / values.size())
+			<< ", \"max\": " << largest << "}";
+	}
+}
+
+
+
+// Load a benchmark definition.
+void Benchmark::Load(const DataNode &node)
+{
+	if(node.Size() >= 2)
+		name = node.Token(1);
+	
+	for(const DataNode &child : node)
+	{
+		if(child.Token(0) == "system" && child.Size() >= 2)
+			system = GameData::Systems().Get(child.Token(1));
+		else if(child.Token(0) == "steps" && child.Size() >= 2)
+			steps = max(1, static_cast<int>(child.Value(1)));
+		else if(child.Token(0) == "seed" && child.Size() >= 2)
+			seed = child.Value(1);
+		else if(child.Token(0) == "fleet")
+			groups.emplace_back(child);
+		else
+			child.PrintTrace("Skipping unrecognized attribute:");
+	}
+}
+
+
+
+const string &Benchmark::Name() const
+{
+	return name;
+}
+
+
+
+// Run this benchmark, and write the results to the given stream.
+bool Benchmark::Run(PlayerInfo &player, ostream &out) const
+{
+	if(!system || system->Name().empty())
+	{
+		Files::LogError("Benchmark \"" + name + "\" does not specify a valid system.");
+		return false;
+	}
+	
+	Messages::Reset();
+	
+	// The player has no ships, so the engine will not "enter" the system or
+	// add any fleets or ships to it other than those given here.
+	player.New();
+	player.SetSystem(system);
+	player.SetPlanet(nullptr);
+	
+	// Make sure every run of this benchmark starts in exactly the same state.
+	// This must come after PlayerInfo::New(), which seeds from the clock.
+	Random::Seed(seed);
+	
+	list<shared_ptr<Ship>> ships;
+	for(const Group &group : groups)
+		for(const pair<const Ship *, int> &it : group.ships)
+			for(int i = 0; i < it.second; ++i)
+			{
+				shared_ptr<Ship> ship(new Ship(*it.first));
+				ship->SetGovernment(group.government);
+				ship->SetPersonality(group.personality);
+				ship->SetSystem(system);
+				
+				Angle angle = Angle::Random();
+				Point pos = group.center + Angle::Random().Unit() * (Random::Real() * group.radius);
+				ship->Place(pos, Point(), angle);
+				ships.push_back(ship);
+			}
+	
+	Engine engine(player);
+	engine.Seed(seed);
+	engine.Place(ships);
+	ships.clear();
+	
+	// The calculation thread only runs between Go() and Wait(), so timing that
+	// interval measures exactly one engine step.
+	vector<double> times;
+	vector<int> shipCounts;
+	vector<int> projectileCounts;
+	vector<int64_t> collisionTests;
+	for(int i = 0; i < steps; ++i)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		engine.Go();
+		engine.Wait();
+		times.push_back(1000. * chrono::duration<double>(chrono::steady_clock::now() - start).count());
+		
+		shipCounts.push_back(engine.ShipCount());
+		projectileCounts.push_back(engine.ProjectileCount());
+		collisionTests.push_back(engine.CollisionTests());
+		
+		engine.Step(false);
+		// Nothing is displaying the messages, so do not let them pile up.
+		Messages::Reset();
+	}
+	
+	vector<double> sorted = times;
+	sort(sorted.begin(), sorted.end());
+	double total = 0.;
+	for(double time : times)
+		total += time;
+	
+	out << "{" << endl;
+	out << "\t\"name\": " << Quote(name) << "," << endl;
+	out << "\t\"steps\": " << steps << "," << endl;
+	out << "\t\"step_ms\": {\"mean\": " << total / steps
+		<< ", \"p50\": " << sorted[sorted.size() / 2]
+		<< ", \"p99\": " << sorted[min(sorted.size() - 1, sorted.size() * 99 / 100)]
+		<< ", \"max\": " << sorted.back() << "}," << endl;
+	WriteSummary(out, "ships", shipCounts);
+	out << "," << endl;
+	WriteSummary(out, "projectiles", projectileCounts);
+	out << "," << endl;
+	WriteSummary(out, "collision_tests", collisionTests);
+	out << endl << "}";
+	
+	return true;
+}
+
+
+
+Benchmark::Group::Group(const DataNode &node)
+{
+	if(node.Size() >= 2)
+		government = GameData::Governments().Get(node.Token(1));
+	
+	for(const DataNode &child : node)
+	{
+		if(child.Token(0) == "government" && child.Size() >= 2)
+			government = GameData::Governments().Get(child.Token(1));
+		else if(child.Token(0) == "personality")
+			personality.Load(child);
+		else if(child.Token(0) == "position" && child.Size() >= 3)
+			center = Point(child.Value(1), child.Value(2));
+		else if(child.Token(0) == "radius" && child.Size() >= 2)
+			radius = child.Value(1);
+		else if(child.Token(0) == "ship" && child.Size() >= 2)
+		{
+			const Ship *model = GameData::Ships().Get(child.Token(1));
+			int count = (child.Size() >= 3 ? max(0, static_cast<int>(child.Value(2))) : 1);
+			if(model->ModelName().empty())
+				child.PrintTrace("Skipping undefined ship model:");
+			else
+				ships.emplace_back(model, count);
+		}
+		else
+			child.PrintTrace("Skipping unrecognized attribute:");
+	}
+	if(!government || government->GetName().empty())
+	{
+		node.PrintTrace("Skipping benchmark fleet with no valid government:");
+		ships.clear();
+	}
+}
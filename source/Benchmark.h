@@ -0,0 +1,74 @@
+/* Benchmark.h
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include "Personality.h"
+#include "Point.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class DataNode;
+class Government;
+class PlayerInfo;
+class Ship;
+class System;
+
+
+
+// A benchmark is a scripted scenario for measuring how fast the simulation
+// runs. It places fleets of the given ship models and governments in a star
+// system, steps the engine for a fixed number of frames without drawing
+// anything, and then reports statistics on the step times in JSON format.
+class Benchmark {
+public:
+	// Load a benchmark definition.
+	void Load(const DataNode &node);
+	
+	const std::string &Name() const;
+	
+	// Run this benchmark, and write the results to the given stream. If the
+	// benchmark could not be set up, this returns false.
+	bool Run(PlayerInfo &player, std::ostream &out) const;
+	
+	
+private:
+	// A group of ships that all belong to the same government, and that start
+	// out scattered around the same point.
+	class Group {
+	public:
+		explicit Group(const DataNode &node);
+		
+		const Government *government = nullptr;
+		Personality personality;
+		Point center;
+		double radius = 1000.;
+		std::vector<std::pair<const Ship *, int>> ships;
+	};
+	
+	
+private:
+	std::string name;
+	const System *system = nullptr;
+	int steps = 3600;
+	uint64_t seed = 0;
+	std::vector<Group> groups;
+};
+
+
+
+#endif
@@ -0,0 +1,114 @@
+/* BodyGrid.cpp
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "BodyGrid.h"
+
+#include "Body.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace std;
+
+
+
+BodyGrid::BodyGrid(int cellSize, int cellCount)
+{
+	// Right shift amount to convert from (x, y) location to grid (x, y).
+	SHIFT = 0;
+	while(cellSize >>= 1)
+		++SHIFT;
+	
+	// Number of grid rows and columns.
+	CELLS = 1;
+	while(cellCount >>= 1)
+		CELLS <<= 1;
+	WRAP_MASK = CELLS - 1;
+	
+	Clear();
+}
+
+
+
+// Remove all objects from the grid.
+void BodyGrid::Clear()
+{
+	cells.clear();
+	sorted.clear();
+	counts.clear();
+	// The counts vector starts with two sentinel slots that will be used in the
+	// course of performing the radix sort.
+	counts.resize(CELLS * CELLS + 2, 0);
+	maxRadius = 0.;
+}
+
+
+
+// Add an object to the grid, in the cell that its center is in.
+void BodyGrid::Add(const Body &body)
+{
+	// Round down rather than toward zero, so that the cells line up with any
+	// square of space that objects repeat in.
+	int gx = (static_cast<int>(floor(body.Position().X())) >> SHIFT) & WRAP_MASK;
+	int gy = (static_cast<int>(floor(body.Position().Y())) >> SHIFT) & WRAP_MASK;
+	int index = gy * CELLS + gx;
+	cells.push_back(index);
+	++counts[index + 2];
+	maxRadius = max(maxRadius, body.Radius());
+}
+
+
+
+// Finish adding objects (and organize them into the final lookup table).
+void BodyGrid::Finish()
+{
+	// Convert the counts of objects in each cell into the index where that
+	// cell begins, then perform a radix sort.
+	partial_sum(counts.begin(), counts.end(), counts.begin());
+	sorted.resize(cells.size());
+	for(unsigned i = 0; i < cells.size(); ++i)
+		sorted[counts[cells[i] + 1]++] = i;
+	
+	// Now, counts[index] is where a certain cell begins.
+}
+
+
+
+// Get the indices of all objects that might be within the given distance of
+// the given point, in no particular order.
+void BodyGrid::Query(const Point &center, double radius, vector<int> &result) const
+{
+	result.clear();
+	if(cells.empty())
+		return;
+	
+	// Any object whose center is farther away than this cannot reach the point.
+	radius += maxRadius;
+	int minX = static_cast<int>(floor(center.X() - radius)) >> SHIFT;
+	int minY = static_cast<int>(floor(center.Y() - radius)) >> SHIFT;
+	int maxX = static_cast<int>(floor(center.X() + radius)) >> SHIFT;
+	int maxY = static_cast<int>(floor(center.Y() + radius)) >> SHIFT;
+	// Because the grid wraps around, make sure no cell is examined twice.
+	maxX = min(maxX, minX + WRAP_MASK);
+	maxY = min(maxY, minY + WRAP_MASK);
+	
+	for(int y = minY; y <= maxY; ++y)
+	{
+		int gy = y & WRAP_MASK;
+		for(int x = minX; x <= maxX; ++x)
+		{
+			int i = gy * CELLS + (x & WRAP_MASK);
+			result.insert(result.end(), sorted.begin() + counts[i], sorted.begin() + counts[i + 1]);
+		}
+	}
+}
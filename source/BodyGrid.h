@@ -0,0 +1,62 @@
+/* BodyGrid.h
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef BODY_GRID_H_
+#define BODY_GRID_H_
+
+#include "Point.h"
+
+#include <vector>
+
+class Body;
+
+
+
+// A grid that keeps track of which cell each object's center is in, so that
+// finding the objects near a point only requires examining the nearby cells.
+// This is laid out like a CollisionSet, except that each object is only stored
+// in one cell. The grid wraps around, so objects far apart may share a cell;
+// a query returns every object that might be in range, not only those that are.
+class BodyGrid {
+public:
+	// The cell size and cell count should both be powers of two.
+	BodyGrid(int cellSize, int cellCount);
+	
+	// Remove all objects from the grid.
+	void Clear();
+	// Add an object to the grid. Objects are identified by the order in which
+	// they were added.
+	void Add(const Body &body);
+	// Finish adding objects (and organize them into the final lookup table).
+	void Finish();
+	
+	// Get the indices of all objects that might be within the given distance
+	// of the given point, in no particular order.
+	void Query(const Point &center, double radius, std::vector<int> &result) const;
+	
+	
+private:
+	int SHIFT;
+	int CELLS;
+	int WRAP_MASK;
+	
+	// The cell each object is in, in the order they were added.
+	std::vector<int> cells;
+	std::vector<int> sorted;
+	std::vector<int> counts;
+	// The largest radius of any object in the grid.
+	double maxRadius = 0.;
+};
+
+
+
+#endif
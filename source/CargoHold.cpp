@@ -27,6 +27,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 using namespace std;
 
 namespace {
+	const int MASS = Outfit::AttributeID("mass");
+	
 	// Retrieve vector of pointers to the outfits, sorted descending by size.
 	vector<const Outfit *> OrderOutfitsBySize(const map<const Outfit *, int> &outfits)
 	{
@@ -37,7 +39,7 @@ namespace {
 		sort(sortedOutfits.begin(), sortedOutfits.end(),
 			[] (const Outfit *lhs, const Outfit *rhs)
 			{
-				return lhs->Get("mass") > rhs->Get("mass");
+				return lhs->Get(MASS) > rhs->Get(MASS);
 			}
 		);
 		
@@ -56,6 +58,7 @@ void CargoHold::Clear()
 	outfits.clear();
 	missionCargo.clear();
 	passengers.clear();
+	used = 0;
 }
 
 
@@ -86,6 +89,7 @@ void CargoHold::Load(const DataNode &node)
 			}
 		}
 	}
+	UpdateUsed();
 }
 
 
@@ -177,7 +181,7 @@ int CargoHold::Free() const
 // (Some outfits may have non-integral masses.)
 int CargoHold::Used() const
 {
-	return CommoditiesSize() + OutfitsSize() + MissionCargoSize();
+	return used;
 }
 
 
@@ -198,7 +202,7 @@ int CargoHold::OutfitsSize() const
 {
 	double size = 0.;
 	for(const auto &it : outfits)
-		size += it.second * it.first->Get("mass");
+		size += it.second * it.first->Get(MASS);
 	return ceil(size);
 }
 
@@ -364,8 +368,12 @@ int CargoHold::Transfer(const string &commodity, int amount, CargoHold *to)
 	
 	// The "to" hold need not be defined.
 	commodities[commodity] -= amount;
+	UpdateUsed();
 	if(to)
+	{
 		to->commodities[commodity] += amount;
+		to->UpdateUsed();
+	}
 	
 	return amount;
 }
@@ -375,7 +383,7 @@ int CargoHold::Transfer(const string &commodity, int amount, CargoHold *to)
 // Transfer outfits from one cargo hold to another.
 int CargoHold::Transfer(const Outfit *outfit, int amount, CargoHold *to)
 {
-	double mass = outfit->Get("mass");
+	double mass = outfit->Get(MASS);
 	
 	// Whichever ship is removing the cargo is limited by how much it has
 	// available. The receiving ship is limited by its free space, but only if
@@ -394,8 +402,12 @@ int CargoHold::Transfer(const Outfit *outfit, int amount, CargoHold *to)
 	
 	// The "to" hold need not be defined.
 	outfits[outfit] -= amount;
+	UpdateUsed();
 	if(to)
+	{
 		to->outfits[outfit] += amount;
+		to->UpdateUsed();
+	}
 	
 	return amount;
 }
@@ -425,8 +437,12 @@ int CargoHold::Transfer(const Mission *mission, int amount, CargoHold *to)
 	
 	// The "to" hold need not be defined.
 	missionCargo[mission] -= amount;
+	UpdateUsed();
 	if(to)
+	{
 		to->missionCargo[mission] += amount;
+		to->UpdateUsed();
+	}
 	
 	return amount;
 }
@@ -471,6 +487,7 @@ void CargoHold::TransferAll(CargoHold *to)
 		outfits.clear();
 		missionCargo.clear();
 		passengers.clear();
+		used = 0;
 		return;
 	}
 	
@@ -539,6 +556,7 @@ void CargoHold::AddMissionCargo(const Mission *mission)
 		missionCargo[mission] += mission->CargoSize();
 	if(mission && mission->Passengers())
 		passengers[mission] += mission->Passengers();
+	UpdateUsed();
 }
 
 
@@ -548,6 +566,7 @@ void CargoHold::RemoveMissionCargo(const Mission *mission)
 {
 	missionCargo.erase(mission);
 	passengers.erase(mission);
+	UpdateUsed();
 }
 
 
@@ -591,3 +610,11 @@ int CargoHold::IllegalCargoFine() const
 	}
 	return worst;
 }
+
+
+
+// Recalculate the total amount of cargo space used.
+void CargoHold::UpdateUsed()
+{
+	used = CommoditiesSize() + OutfitsSize() + MissionCargoSize();
+}
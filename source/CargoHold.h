@@ -104,6 +104,11 @@ public:
 	int IllegalCargoFine() const;
 	
 	
+private:
+	// Recalculate the total amount of cargo space used.
+	void UpdateUsed();
+	
+	
 private:
 	// Use -1 to indicate unlimited capacity.
 	int size = -1;
@@ -114,6 +119,10 @@ private:
 	std::map<const Outfit *, int> outfits;
 	std::map<const Mission *, int> missionCargo;
 	std::map<const Mission *, int> passengers;
+	
+	// The total cargo space used is needed every time a ship's mass is
+	// checked, so it is recalculated only when the contents change.
+	int used = 0;
 };
 
 
@@ -22,15 +22,51 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include <algorithm>
 #include <cstdlib>
 #include <numeric>
-#include <set>
 
 using namespace std;
 
+namespace {
+	// An object that spans several grid cells must only be checked once by
+	// each query. Rather than building a set of the objects a query has seen,
+	// each query has its own number, and each object records the number of
+	// the last query that saw it. Each thread that runs queries has its own
+	// stamps, so queries on different threads do not interfere.
+	thread_local vector<uint32_t> seen;
+	thread_local uint32_t query = 0;
+	
+	// Begin a new query of a set with the given number of objects, so that no
+	// object has been seen by it yet.
+	void NextQuery(size_t objects)
+	{
+		if(seen.size() < objects)
+			seen.resize(objects, 0);
+		// If the query number wraps around, old stamps might match new queries.
+		if(!++query)
+		{
+			fill(seen.begin(), seen.end(), 0);
+			query = 1;
+		}
+	}
+	
+	// Check if the object with the given ID has been seen by the current
+	// query, and mark it as seen if it has not been.
+	bool Seen(int id)
+	{
+		uint32_t &stamp = seen[id];
+		if(stamp == query)
+			return true;
+		
+		stamp = query;
+		return false;
+	}
+}
+
 
 
 // Initialize a collision set. The cell size and cell count should both be
 // powers of two; otherwise, they are rounded down to a power of two.
 CollisionSet::CollisionSet(int cellSize, int cellCount)
+	: tests(0)
 {
 	// Right shift amount to convert from (x, y) location to grid (x, y).
 	SHIFT = 0;
@@ -55,6 +91,8 @@ CollisionSet::CollisionSet(int cellSize, int cellCount)
 void CollisionSet::Clear(int step)
 {
 	this->step = step;
+	tests = 0;
+	objects = 0;
 	
 	added.clear();
 	sorted.clear();
@@ -75,6 +113,9 @@ void CollisionSet::Add(Body &body)
 	int maxX = static_cast<int>(body.Position().X() + body.Radius()) >> SHIFT;
 	int maxY = static_cast<int>(body.Position().Y() + body.Radius()) >> SHIFT;
 	
+	// Give this object an ID for recording which query last saw it.
+	int id = objects++;
+	
 	// Add a pointer to this object in every grid cell it occupies.
 	for(int y = minY; y <= maxY; ++y)
 	{
@@ -82,7 +123,7 @@ void CollisionSet::Add(Body &body)
 		for(int x = minX; x <= maxX; ++x)
 		{
 			int gx = x & WRAP_MASK;
-			added.emplace_back(&body, x, y);
+			added.emplace_back(&body, id, x, y);
 			++counts[gy * CELLS + gx + 2];
 		}
 	}
@@ -139,6 +180,7 @@ Body *CollisionSet::Line(const Projectile &projectile, double *closestHit) const
 	// Keep track of the closest collision found so far.
 	double closest = 1.;
 	Body *result = nullptr;
+	int64_t count = 0;
 	
 	// Special case, very common: the projectile is contained in one grid cell.
 	// In this case, all the complicated code below can be skipped.
@@ -161,6 +203,7 @@ Body *CollisionSet::Line(const Projectile &projectile, double *closestHit) const
 			if(it->body != projectile.Target() && iGov && pGov && !iGov->IsEnemy(pGov))
 				continue;
 			
+			++count;
 			const Mask &mask = it->body->GetMask(step);
 			Point offset = projectile.Position() - it->body->Position();
 			double range = mask.Collide(offset, projectile.Velocity(), it->body->Facing());
@@ -171,6 +214,7 @@ Body *CollisionSet::Line(const Projectile &projectile, double *closestHit) const
 				result = it->body;
 			}
 		}
+		tests += count;
 		if(closest < 1. && closestHit)
 			*closestHit = closest;
 		return result;
@@ -197,7 +241,7 @@ Body *CollisionSet::Line(const Projectile &projectile, double *closestHit) const
 		ry = full - ry;
 	
 	// Keep track of which objects we've already considered.
-	set<const Body *> seen;
+	NextQuery(objects);
 	while(true)
 	{
 		// Examine all objects in the current grid cell.
@@ -211,9 +255,8 @@ Body *CollisionSet::Line(const Projectile &projectile, double *closestHit) const
 			if(it->x != gx || it->y != gy)
 				continue;
 			
-			if(seen.count(it->body))
+			if(Seen(it->id))
 				continue;
-			seen.insert(it->body);
 			
 			// Check if this projectile can hit this object. If either the
 			// projectile or the object has no government, it will always hit.
@@ -221,6 +264,7 @@ Body *CollisionSet::Line(const Projectile &projectile, double *closestHit) const
 			if(it->body != projectile.Target() && iGov && pGov && !iGov->IsEnemy(pGov))
 				continue;
 			
+			++count;
 			const Mask &mask = it->body->GetMask(step);
 			Point offset = projectile.Position() - it->body->Position();
 			double range = mask.Collide(offset, projectile.Velocity(), it->body->Facing());
@@ -268,6 +312,7 @@ Body *CollisionSet::Line(const Projectile &projectile, double *closestHit) const
 			gy += stepY;
 		}
 	}
+	tests += count;
 	
 	if(closest < 1. && closestHit)
 		*closestHit = closest;
@@ -276,8 +321,9 @@ Body *CollisionSet::Line(const Projectile &projectile, double *closestHit) const
 
 
 
-// Get all objects within the given range of the given point.
-const vector<Body *> &CollisionSet::Circle(const Point &center, double radius) const
+// Get all objects within the given range of the given point. The result
+// vector is cleared first, so the caller can reuse it for each query.
+void CollisionSet::Circle(const Point &center, double radius, vector<Body *> &result) const
 {
 	// Calculate the range of (x, y) grid coordinates this circle covers.
 	int minX = static_cast<int>(center.X() - radius) >> SHIFT;
@@ -286,8 +332,9 @@ const vector<Body *> &CollisionSet::Circle(const Point &center, double radius) c
 	int maxY = static_cast<int>(center.Y() + radius) >> SHIFT;
 	
 	// Keep track of which objects we've already considered.
-	set<const Body *> seen;
+	NextQuery(objects);
 	result.clear();
+	int64_t count = 0;
 	for(int y = minY; y <= maxY; ++y)
 	{
 		int gy = y & WRAP_MASK;
@@ -305,10 +352,10 @@ const vector<Body *> &CollisionSet::Circle(const Point &center, double radius) c
 				if(it->x != x || it->y != y)
 					continue;
 				
-				if(seen.count(it->body))
+				if(Seen(it->id))
 					continue;
-				seen.insert(it->body);
 				
+				++count;
 				const Mask &mask = it->body->GetMask(step);
 				Point offset = center - it->body->Position();
 				if(offset.Length() <= radius || mask.WithinRange(offset, it->body->Facing(), radius))
@@ -316,5 +363,14 @@ const vector<Body *> &CollisionSet::Circle(const Point &center, double radius) c
 			}
 		}
 	}
-	return result;
+	tests += count;
+}
+
+
+
+// Get the number of object masks that have been tested for a collision since
+// the last call to Clear(). This is used for benchmarking.
+int64_t CollisionSet::Tests() const
+{
+	return tests;
 }
@@ -13,6 +13,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef COLLISION_SET_H_
 #define COLLISION_SET_H_
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 class Body;
@@ -23,7 +25,8 @@ class Projectile;
 
 // A CollisionSet allows efficient collision detection by splitting space up
 // into a grid and keeping track of which objects are in each grid cell. A check
-// for collisions can then only examine objects in certain cells.
+// for collisions can then only examine objects in certain cells. Once Finish()
+// has been called, any number of threads may query the set at the same time.
 class CollisionSet {
 public:
 	// Initialize a collision set. The cell size and cell count should both be
@@ -42,22 +45,31 @@ public:
 	// "closest hit" value is given, update that value.
 	Body *Line(const Projectile &projectile, double *closestHit = nullptr) const;
 	
-	// Get all objects within the given range of the given point.
-	const std::vector<Body *> &Circle(const Point &center, double radius) const;
+	// Get all objects within the given range of the given point. The result
+	// vector is cleared first, so the caller can reuse it for each query.
+	void Circle(const Point &center, double radius, std::vector<Body *> &result) const;
+	
+	// Get the number of object masks that have been tested for a collision
+	// since the last call to Clear(). This is used for benchmarking.
+	int64_t Tests() const;
 	
 	
 private:
 	class Entry {
 	public:
 		Entry() = default;
-		Entry(Body *body, int x, int y) : body(body), x(x), y(y) {}
+		Entry(Body *body, int id, int x, int y) : body(body), id(id), x(x), y(y) {}
 		
 		Body *body;
+		// The index of this object's stamp in the "seen" vector.
+		int id;
 		int x;
 		int y;
 	};
 	
 	
+	
+	
 private:
 	// The size of individual cells of the grid.
 	int CELL_SIZE;
@@ -75,9 +87,11 @@ private:
 	std::vector<Entry> added;
 	std::vector<Entry> sorted;
 	std::vector<int> counts;
+	// The number of objects added, each of which has its own ID.
+	int objects = 0;
 	
-	// Vector for returning the result of a circle query.
-	mutable std::vector<Body *> result;
+	// Count of mask collision tests performed.
+	mutable std::atomic<int64_t> tests;
 };
 
 
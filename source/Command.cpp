@@ -255,6 +255,21 @@ Command Command::AndNot(Command command) const
 
 
 
+// Get or set all the command bits at once.
+uint64_t Command::State() const
+{
+	return state;
+}
+
+
+
+void Command::SetState(uint64_t bits)
+{
+	state = bits;
+}
+
+
+
 // Set the turn direction and amount to a value between -1 and 1.
 void Command::SetTurn(double amount)
 {
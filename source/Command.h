@@ -95,6 +95,10 @@ public:
 	bool Has(Command command) const;
 	// Get the commands that are set in this and not in the given command.
 	Command AndNot(Command command) const;
+	// Get or set all the command bits at once, e.g. to record and replay the
+	// keys the player held down. This ignores the turn and aim fields.
+	uint64_t State() const;
+	void SetState(uint64_t bits);
 	
 	// Get or set the turn amount. The amount must be between -1 and 1, but it
 	// can be a fractional value to allow finer control.
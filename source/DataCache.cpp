@@ -0,0 +1,192 @@
+/* DataCache.cpp
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "DataCache.h"
+
+#include "DataFile.h"
+#include "Files.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+using namespace std;
+
+namespace {
+	// The cache starts with this text. If the binary format ever changes, the
+	// version number at the end of it must change too, so old caches are not
+	// used by mistake.
+	const char HEADER[] = "Endless Sky data cache 2\n";
+	const size_t HEADER_SIZE = sizeof(HEADER) - 1;
+	
+	// The cache is only ever read on the machine that wrote it, so the sizes
+	// and times that describe each file are just stored as 64-bit integers.
+	void WriteNumber(string &out, uint64_t value)
+	{
+		out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+	
+	bool ReadNumber(const char *&it, const char *end, uint64_t &value)
+	{
+		if(static_cast<size_t>(end - it) < sizeof(value))
+			return false;
+		memcpy(&value, it, sizeof(value));
+		it += sizeof(value);
+		return true;
+	}
+	
+	// Each file's data is stored with a checksum, so that if the cache is
+	// damaged somehow, the file is parsed again instead of loading bad data.
+	uint64_t Checksum(const char *it, const char *end)
+	{
+		// This is the 64-bit FNV-1a hash.
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		for( ; it != end; ++it)
+		{
+			hash ^= static_cast<unsigned char>(*it);
+			hash *= 0x100000001b3ULL;
+		}
+		return hash;
+	}
+	
+	// Read a number that is a length in bytes, and make sure that many bytes
+	// actually remain in the data.
+	bool ReadLength(const char *&it, const char *end, uint64_t &value)
+	{
+		return ReadNumber(it, end, value) && value <= static_cast<uint64_t>(end - it);
+	}
+}
+
+
+
+// Open the cache stored in the given file, and check which of the given data
+// files it has up to date copies of.
+DataCache::DataCache(const string &cachePath, const vector<string> &paths)
+	: cachePath(cachePath), paths(paths), entries(paths.size()), isStale(false)
+{
+	for(size_t i = 0; i < paths.size(); ++i)
+	{
+		entries[i].size = Files::Size(paths[i]);
+		entries[i].time = Files::Timestamp(paths[i]);
+	}
+	
+	// Find out what files are in the cache, and where.
+	map<string, Entry> cached;
+	file.reset(new MappedFile(cachePath));
+	const char *it = file->begin();
+	const char *end = file->end();
+	if(file->size() >= HEADER_SIZE && !memcmp(it, HEADER, HEADER_SIZE))
+	{
+		it += HEADER_SIZE;
+		while(it != end)
+		{
+			uint64_t length = 0;
+			if(!ReadLength(it, end, length))
+				break;
+			string path(it, it + length);
+			it += length;
+			
+			Entry entry;
+			uint64_t size = 0;
+			uint64_t time = 0;
+			uint64_t checksum = 0;
+			if(!ReadNumber(it, end, size) || !ReadNumber(it, end, time)
+					|| !ReadNumber(it, end, checksum) || !ReadLength(it, end, length))
+				break;
+			entry.size = size;
+			entry.time = time;
+			entry.begin = it;
+			entry.end = it + length;
+			it += length;
+			if(Checksum(entry.begin, entry.end) == checksum)
+				cached.emplace(path, entry);
+		}
+	}
+	
+	// If any files are not in the cache, or the cache has files that are not in
+	// the list, the cache needs to be saved again.
+	isStale = (cached.size() != paths.size());
+	for(size_t i = 0; i < paths.size(); ++i)
+	{
+		auto cit = cached.find(paths[i]);
+		if(cit != cached.end() && cit->second.size == entries[i].size && cit->second.time == entries[i].time)
+		{
+			entries[i].begin = cit->second.begin;
+			entries[i].end = cit->second.end;
+		}
+		else
+			isStale = true;
+	}
+}
+
+
+
+DataCache::~DataCache()
+{
+}
+
+
+
+// Load the data file with the given index in the list of paths, from the cache
+// if possible. This may be called from several threads at once.
+void DataCache::Load(size_t index, DataFile &file)
+{
+	const Entry &entry = entries[index];
+	if(entry.begin && file.LoadBinary(entry.begin, entry.end))
+		return;
+	
+	isStale = true;
+	file.Load(paths[index]);
+}
+
+
+
+// Check if any of the files had to be parsed, meaning that the cache needs to
+// be saved again.
+bool DataCache::IsStale() const
+{
+	return isStale;
+}
+
+
+
+// Save the given files, in the same order as the list of paths.
+void DataCache::Save(const vector<unique_ptr<DataFile>> &files)
+{
+	// The cached data cannot be overwritten while it is still in use.
+	file.reset();
+	for(Entry &entry : entries)
+		entry.begin = entry.end = nullptr;
+	
+	string out(HEADER, HEADER_SIZE);
+	string data;
+	for(size_t i = 0; i < paths.size() && i < files.size(); ++i)
+	{
+		data.clear();
+		files[i]->SaveBinary(data);
+		
+		WriteNumber(out, paths[i].size());
+		out += paths[i];
+		WriteNumber(out, entries[i].size);
+		WriteNumber(out, entries[i].time);
+		WriteNumber(out, Checksum(data.data(), data.data() + data.size()));
+		WriteNumber(out, data.size());
+		out += data;
+	}
+	
+	// Write to a temporary file first, so that if the game is closed partway
+	// through, the cache is not left half written.
+	string temporaryPath = cachePath + "~";
+	Files::Write(temporaryPath, out);
+	Files::Move(temporaryPath, cachePath);
+}
@@ -0,0 +1,72 @@
+/* DataCache.h
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef DATA_CACHE_H_
+#define DATA_CACHE_H_
+
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+class DataFile;
+class MappedFile;
+
+
+
+// A cache of the parsed contents of the game's data files, stored in binary
+// form in a single file so that the text of each data file does not need to be
+// parsed again every time the game starts. A data file's cached copy is only
+// used if the file still has the same size and modification time as when it
+// was cached; any file that has changed is parsed as usual.
+class DataCache {
+public:
+	// Open the cache stored in the given file, and check which of the given
+	// data files it has up to date copies of.
+	DataCache(const std::string &cachePath, const std::vector<std::string> &paths);
+	~DataCache();
+	
+	// Load the data file with the given index in the list of paths, from the
+	// cache if possible. This may be called from several threads at once.
+	void Load(size_t index, DataFile &file);
+	// Check if any of the files had to be parsed, meaning that the cache
+	// needs to be saved again.
+	bool IsStale() const;
+	// Save the given files, in the same order as the list of paths. After this,
+	// the old cached data is no longer available.
+	void Save(const std::vector<std::unique_ptr<DataFile>> &files);
+	
+	
+private:
+	class Entry {
+	public:
+		// The file's size and modification time when the cache was opened.
+		size_t size = 0;
+		std::time_t time = 0;
+		// If the file has not changed, this is where its cached copy is.
+		const char *begin = nullptr;
+		const char *end = nullptr;
+	};
+	
+	
+private:
+	std::string cachePath;
+	std::vector<std::string> paths;
+	std::vector<Entry> entries;
+	std::unique_ptr<MappedFile> file;
+	std::atomic<bool> isStale;
+};
+
+
+
+#endif
@@ -12,10 +12,51 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "DataFile.h"
 
-#include "Files.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <iterator>
 
 using namespace std;
 
+namespace {
+	// While a file is being parsed, each line is first recorded as the range
+	// of the text that each of its tokens occupies, so that no copies are made
+	// until it is known how big each node's lists of children and tokens are.
+	class Line {
+	public:
+		Line(int parent, size_t firstToken) : parent(parent), firstToken(firstToken) {}
+		
+		// The index of this line's parent, or -1 if it is a child of the root.
+		int parent;
+		size_t firstToken;
+		int children = 0;
+		bool isMissingQuote = false;
+	};
+	
+	// Numbers in the binary form are stored seven bits at a time, with the
+	// high bit of each byte set if more bytes follow.
+	void WriteCount(string &out, size_t value)
+	{
+		for( ; value >= 0x80; value >>= 7)
+			out += static_cast<char>(value | 0x80);
+		out += static_cast<char>(value);
+	}
+	
+	bool ReadCount(const char *&it, const char *end, size_t &value)
+	{
+		value = 0;
+		for(int shift = 0; it != end && shift < 64; shift += 7)
+		{
+			unsigned char c = *it++;
+			value |= static_cast<size_t>(c & 0x7F) << shift;
+			if(!(c & 0x80))
+				return true;
+		}
+		return false;
+	}
+}
+
 
 
 // Constructor, taking a file path (in UTF-8).
@@ -37,15 +78,20 @@ DataFile::DataFile(istream &in)
 // Load from a file path (in UTF-8).
 void DataFile::Load(const string &path)
 {
-	string data = Files::Read(path);
-	if(data.empty())
+	MappedFile file(path);
+	if(file.empty())
 		return;
 	
-	// As a sentinel, make sure the file always ends in a newline.
-	if(data.empty() || data.back() != '\n')
+	// The parser uses a newline as a sentinel, so the file must end in one. If
+	// it does, it can be parsed in place, without copying it.
+	if(file.end()[-1] == '\n')
+		Load(file.begin(), file.end());
+	else
+	{
+		string data(file.begin(), file.end());
 		data.push_back('\n');
-	
-	Load(&*data.begin(), &*data.end());
+		Load(&*data.begin(), &*data.end());
+	}
 	
 	// Note what file this node is in, so it will show up in error traces.
 	root.tokens.push_back("file");
@@ -57,18 +103,10 @@ void DataFile::Load(const string &path)
 // Constructor, taking an istream. This can be cin or a file.
 void DataFile::Load(istream &in)
 {
-	vector<char> data;
+	string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
 	
-	static const size_t BLOCK = 4096;
-	while(in)
-	{
-		size_t currentSize = data.size();
-		data.resize(currentSize + BLOCK);
-		in.read(&*data.begin() + currentSize, BLOCK);
-		data.resize(currentSize + in.gcount());
-	}
 	// As a sentinel, make sure the file always ends in a newline.
-	if(data.back() != '\n')
+	if(data.empty() || data.back() != '\n')
 		data.push_back('\n');
 	
 	Load(&*data.begin(), &*data.end());
@@ -76,8 +114,40 @@ void DataFile::Load(istream &in)
 
 
 
+// Convert this file's nodes to a compact binary form.
+void DataFile::SaveBinary(string &out) const
+{
+	SaveNode(root, out);
+}
+
+
+
+// Load nodes that were saved by SaveBinary(). If the data is not valid, this
+// file is left unchanged.
+bool DataFile::LoadBinary(const char *it, const char *end)
+{
+	DataNode node;
+	vector<const DataNode *> loadedMissingQuotes;
+	if(!LoadNode(node, it, end, loadedMissingQuotes) || it != end)
+		return false;
+	// The root node does not come from a line of text, so it cannot be
+	// missing a quotation mark.
+	if(!loadedMissingQuotes.empty() && loadedMissingQuotes.front() == &node)
+		return false;
+	
+	// Moving the root node does not move any of its children, so the pointers
+	// to them are still valid.
+	root = move(node);
+	missingQuotes = move(loadedMissingQuotes);
+	for(const DataNode *missing : missingQuotes)
+		missing->PrintTrace("Closing quotation mark is missing:");
+	return true;
+}
+
+
+
 // Get an iterator to the start of the list of nodes in this file.
-list<DataNode>::const_iterator DataFile::begin() const
+vector<DataNode>::const_iterator DataFile::begin() const
 {
 	return root.begin();
 }
@@ -85,7 +155,7 @@ list<DataNode>::const_iterator DataFile::begin() const
 
 
 // Get an iterator to the end of the list of nodes in this file.
-list<DataNode>::const_iterator DataFile::end() const
+vector<DataNode>::const_iterator DataFile::end() const
 {
 	return root.end();
 }
@@ -95,10 +165,19 @@ list<DataNode>::const_iterator DataFile::end() const
 // Parse the given text.
 void DataFile::Load(const char *it, const char *end)
 {
+	// The parsing is done in two passes. The first pass finds where each token
+	// is in the text and which line each line is a child of. The second pass
+	// creates the nodes, with the exact amount of space that each one needs
+	// for its children and tokens reserved ahead of time, so that no node
+	// ever has to be moved or reallocated.
+	vector<Line> lines;
+	vector<pair<const char *, const char *>> tokens;
+	int rootChildren = 0;
+	
 	// Keep track of the current stack of indentation levels and the most recent
-	// node at each level - that is, the node that will be the "parent" of any
-	// new node added at the next deeper indentation level.
-	vector<DataNode *> stack(1, &root);
+	// line at each level - that is, the line that will be the "parent" of any
+	// new line added at the next deeper indentation level.
+	vector<int> stack(1, -1);
 	vector<int> whiteStack(1, -1);
 	
 	for( ; it != end; ++it)
@@ -126,14 +205,14 @@ void DataFile::Load(const char *it, const char *end)
 			stack.pop_back();
 		}
 		
-		// Add this node as a child of the proper node.
-		list<DataNode> &children = stack.back()->children;
-		children.emplace_back(stack.back());
-		DataNode &node = children.back();
+		// Add this line as a child of the proper line.
+		int parent = stack.back();
+		++(parent < 0 ? rootChildren : lines[parent].children);
 		
 		// Remember where in the tree we are.
-		stack.push_back(&node);
+		stack.push_back(lines.size());
 		whiteStack.push_back(white);
+		lines.emplace_back(parent, tokens.size());
 		
 		// Tokenize the line. Skip comments and empty lines.
 		while(*it != '\n')
@@ -150,16 +229,10 @@ void DataFile::Load(const char *it, const char *end)
 			while(*it != '\n' && (isQuoted ? (*it != endQuote) : (*it > ' ')))
 				++it;
 			
-			// It ought to be legal to construct a string from an empty iterator
-			// range, but it appears that some libraries do not handle that case
-			// correctly. So:
-			if(start == it)
-				node.tokens.emplace_back();
-			else
-				node.tokens.emplace_back(start, it);
+			tokens.emplace_back(start, it);
 			// This is not a fatal error, but it may indicate a format mistake:
 			if(isQuoted && *it == '\n')
-				node.PrintTrace("Closing quotation mark is missing:");
+				lines.back().isMissingQuote = true;
 			
 			if(*it != '\n')
 			{
@@ -179,4 +252,100 @@ void DataFile::Load(const char *it, const char *end)
 			}
 		}
 	}
+	
+	// Now, create the nodes. Each line comes after its parent in the file, so
+	// its parent's node will already exist.
+	vector<DataNode *> nodes;
+	nodes.reserve(lines.size());
+	root.children.reserve(root.children.size() + rootChildren);
+	for(size_t i = 0; i < lines.size(); ++i)
+	{
+		const Line &line = lines[i];
+		DataNode *parent = (line.parent < 0) ? &root : nodes[line.parent];
+		parent->children.emplace_back(parent);
+		DataNode &node = parent->children.back();
+		nodes.push_back(&node);
+		node.children.reserve(line.children);
+		
+		size_t lastToken = (i + 1 < lines.size()) ? lines[i + 1].firstToken : tokens.size();
+		node.tokens.reserve(lastToken - line.firstToken);
+		for(size_t j = line.firstToken; j < lastToken; ++j)
+		{
+			// It ought to be legal to construct a string from an empty iterator
+			// range, but it appears that some libraries do not handle that case
+			// correctly. So:
+			if(tokens[j].first == tokens[j].second)
+				node.tokens.emplace_back();
+			else
+				node.tokens.emplace_back(tokens[j].first, tokens[j].second);
+		}
+		if(line.isMissingQuote)
+		{
+			missingQuotes.push_back(&node);
+			node.PrintTrace("Closing quotation mark is missing:");
+		}
+	}
+}
+
+
+
+// Write a node and all its children in binary form: the number of tokens,
+// each token's length and text, and then the number of children. The number
+// of tokens is doubled, and one is added to it if this line was missing a
+// closing quotation mark.
+void DataFile::SaveNode(const DataNode &node, string &out) const
+{
+	bool isMissingQuote = (find(missingQuotes.begin(), missingQuotes.end(), &node) != missingQuotes.end());
+	WriteCount(out, 2 * node.tokens.size() + isMissingQuote);
+	for(const string &token : node.tokens)
+	{
+		WriteCount(out, token.size());
+		out += token;
+	}
+	WriteCount(out, node.children.size());
+	for(const DataNode &child : node.children)
+		SaveNode(child, out);
+}
+
+
+
+// Read a node written by SaveNode(), making sure that nothing it says about
+// the sizes of things goes past the end of the data.
+bool DataFile::LoadNode(DataNode &node, const char *&it, const char *end, vector<const DataNode *> &missingQuotes)
+{
+	// Every token and child takes up at least one byte, so a count bigger than
+	// the remaining data means the data is not valid.
+	size_t count = 0;
+	if(!ReadCount(it, end, count))
+		return false;
+	if(count & 1)
+		missingQuotes.push_back(&node);
+	count /= 2;
+	if(count > static_cast<size_t>(end - it))
+		return false;
+	node.tokens.reserve(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		size_t length = 0;
+		if(!ReadCount(it, end, length) || length > static_cast<size_t>(end - it))
+			return false;
+		if(length)
+			node.tokens.emplace_back(it, it + length);
+		else
+			node.tokens.emplace_back();
+		it += length;
+	}
+	
+	if(!ReadCount(it, end, count) || count > static_cast<size_t>(end - it))
+		return false;
+	// Reserving space for all the children first means they never move, so
+	// their parent pointers stay valid.
+	node.children.reserve(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		node.children.emplace_back(&node);
+		if(!LoadNode(node.children.back(), it, end, missingQuotes))
+			return false;
+	}
+	return true;
 }
@@ -16,7 +16,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "DataNode.h"
 
 #include <istream>
-#include <list>
+#include <string>
+#include <vector>
 
 
 
@@ -32,22 +33,36 @@ public:
 	DataFile() = default;
 	explicit DataFile(const std::string &path);
 	explicit DataFile(std::istream &in);
+	// A DataFile keeps pointers to some of its own nodes, so it cannot be copied.
+	DataFile(const DataFile &) = delete;
+	DataFile &operator=(const DataFile &) = delete;
 	
 	void Load(const std::string &path);
 	void Load(std::istream &in);
 	
+	// Convert this file's nodes to or from a compact binary form, so that they
+	// can be cached instead of parsing the same text again. LoadBinary() returns
+	// false, and leaves this file unchanged, if the data is not valid.
+	void SaveBinary(std::string &out) const;
+	bool LoadBinary(const char *it, const char *end);
+	
 	// Functions for iterating through all DataNodes in this file.
-	std::list<DataNode>::const_iterator begin() const;
-	std::list<DataNode>::const_iterator end() const;
+	std::vector<DataNode>::const_iterator begin() const;
+	std::vector<DataNode>::const_iterator end() const;
 	
 	
 private:
 	void Load(const char *it, const char *end);
+	void SaveNode(const DataNode &node, std::string &out) const;
+	static bool LoadNode(DataNode &node, const char *&it, const char *end, std::vector<const DataNode *> &missingQuotes);
 	
 	
 private:
 	// This is the container for all DataNodes in this file.
 	DataNode root;
+	// Any lines that are missing a closing quotation mark. These are saved in
+	// the binary form, so the warning is printed again whenever it is loaded.
+	std::vector<const DataNode *> missingQuotes;
 };
 
 
@@ -26,10 +26,6 @@ using namespace std;
 DataNode::DataNode(const DataNode *parent)
 	: parent(parent)
 {
-	// To avoid a lot of memory reallocation, have every node start out with
-	// capacity for four tokens. This makes file loading slightly faster, at the
-	// cost of DataFiles taking up a bit more memory.
-	tokens.reserve(4);
 }
 
 
@@ -43,6 +39,16 @@ DataNode::DataNode(const DataNode &other)
 
 
 
+// Move constructor. A node that is moved keeps its parent, because this
+// happens when the list of children it is in needs to be reallocated.
+DataNode::DataNode(DataNode &&other) noexcept
+	: children(move(other.children)), tokens(move(other.tokens)), parent(other.parent)
+{
+	Reparent();
+}
+
+
+
 // Assignment operator.
 DataNode &DataNode::operator=(const DataNode &other)
 {
@@ -54,6 +60,18 @@ DataNode &DataNode::operator=(const DataNode &other)
 
 
 
+// Move assignment operator.
+DataNode &DataNode::operator=(DataNode &&other) noexcept
+{
+	children = move(other.children);
+	tokens = move(other.tokens);
+	parent = other.parent;
+	Reparent();
+	return *this;
+}
+
+
+
 // Get the number of tokens in this line of the data file.
 int DataNode::Size() const
 {
@@ -182,7 +200,7 @@ bool DataNode::HasChildren() const
 
 
 // Iterator to the beginning of the list of children.
-list<DataNode>::const_iterator DataNode::begin() const
+vector<DataNode>::const_iterator DataNode::begin() const
 {
 	return children.begin();
 }
@@ -190,7 +208,7 @@ list<DataNode>::const_iterator DataNode::begin() const
 
 
 // Iterator to the end of the list of children.
-list<DataNode>::const_iterator DataNode::end() const
+vector<DataNode>::const_iterator DataNode::end() const
 {
 	return children.end();
 }
@@ -237,12 +255,12 @@ int DataNode::PrintTrace(const string &message) const
 
 
 
-// Adjust the parent pointers when a copy is made of a DataNode.
+// Adjust the parent pointers when a copy is made of a DataNode or when it is
+// moved to a new place in memory. Only the direct children need to be updated:
+// when the children are copied, each one's copy constructor updates its own
+// children, and when they are moved, the grandchildren do not move at all.
 void DataNode::Reparent()
 {
 	for(DataNode &child : children)
-	{
 		child.parent = this;
-		child.Reparent();
-	}
 }
@@ -13,7 +13,6 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef DATA_NODE_H_
 #define DATA_NODE_H_
 
-#include <list>
 #include <string>
 #include <vector>
 
@@ -32,8 +31,12 @@ public:
 	explicit DataNode(const DataNode *parent = nullptr);
 	// Copy constructor.
 	DataNode(const DataNode &other);
+	// Move constructor. The children stay where they are in memory, so this
+	// is much cheaper than making a copy.
+	DataNode(DataNode &&other) noexcept;
 	
 	DataNode &operator=(const DataNode &other);
+	DataNode &operator=(DataNode &&other) noexcept;
 	
 	// Get the number of tokens in this node.
 	int Size() const;
@@ -49,21 +52,23 @@ public:
 	// Check if this node has any children. If so, the iterator functions below
 	// can be used to access them.
 	bool HasChildren() const;
-	std::list<DataNode>::const_iterator begin() const;
-	std::list<DataNode>::const_iterator end() const;
+	std::vector<DataNode>::const_iterator begin() const;
+	std::vector<DataNode>::const_iterator end() const;
 	
 	// Print a message followed by a "trace" of this node and its parents.
 	int PrintTrace(const std::string &message = "") const;
 	
 	
 private:
-	// Adjust the parent pointers when a copy is made of a DataNode.
+	// Adjust the parent pointers when a copy is made of a DataNode or when it
+	// is moved to a new place in memory.
 	void Reparent();
 	
 	
 private:
 	// These are "child" nodes found on subsequent lines with deeper indentation.
-	std::list<DataNode> children;
+	// They are stored contiguously, in the order they appear in the file.
+	std::vector<DataNode> children;
 	// These are the tokens found in this particular line of the data file.
 	std::vector<std::string> tokens;
 	// The parent pointer is used only for printing stack traces.
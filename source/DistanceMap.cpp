@@ -17,8 +17,71 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Ship.h"
 #include "System.h"
 
+#include <list>
+#include <mutex>
+#include <tuple>
+
 using namespace std;
 
+namespace {
+	// Everything a map that does not depend on the player's knowledge depends
+	// on: the center and source systems, the maximum count and distance, the
+	// fuel used by each type of drive, and whether wormholes are used.
+	typedef tuple<const System *, const System *, int, int, int, int, bool> Key;
+	
+	// The most recently used maps are kept, with the most recent at the front.
+	const size_t CACHE_SIZE = 256;
+	list<pair<Key, shared_ptr<const DistanceMap>>> cache;
+	map<Key, list<pair<Key, shared_ptr<const DistanceMap>>>::iterator> cacheIndex;
+	// This changes every time the cache is cleared, so that a map that was
+	// being calculated at the time, from out of date information, is not added.
+	uint64_t cacheGeneration = 0;
+	mutex cacheMutex;
+	
+	// Find the cached map with the given key, if there is one. Also get the
+	// current generation of the cache, to pass to AddCached().
+	shared_ptr<const DistanceMap> FindCached(const Key &key, uint64_t &generation)
+	{
+		lock_guard<mutex> lock(cacheMutex);
+		generation = cacheGeneration;
+		auto it = cacheIndex.find(key);
+		if(it == cacheIndex.end())
+			return nullptr;
+		
+		cache.splice(cache.begin(), cache, it->second);
+		return it->second->second;
+	}
+	
+	// Add the given map to the cache, dropping the least recently used map if
+	// the cache is full.
+	void AddCached(const Key &key, const shared_ptr<const DistanceMap> &distance, uint64_t generation)
+	{
+		lock_guard<mutex> lock(cacheMutex);
+		// Another thread may have added this map in the meantime, or cleared
+		// the cache because something the map depends on has changed.
+		if(generation != cacheGeneration || cacheIndex.count(key))
+			return;
+		
+		cache.emplace_front(key, distance);
+		cacheIndex[key] = cache.begin();
+		if(cache.size() > CACHE_SIZE)
+		{
+			cacheIndex.erase(cache.back().first);
+			cache.pop_back();
+		}
+	}
+	
+	// Get how much fuel the given ship uses for each type of jump. If both cost
+	// the same, there is no need to check hyperjump paths at all.
+	void GetDriveFuel(const Ship &ship, int &hyperspaceFuel, int &jumpFuel)
+	{
+		hyperspaceFuel = ship.HyperdriveFuel();
+		jumpFuel = ship.JumpDriveFuel();
+		if(hyperspaceFuel == jumpFuel)
+			hyperspaceFuel = 0;
+	}
+}
+
 
 
 // Find paths to the given system. If the given maximum count is above zero,
@@ -96,6 +159,60 @@ const System *DistanceMap::Route(const System *system) const
 	
 	
 	
+// Get a distance map of paths to the given system, calculating it only if it is
+// not already cached.
+shared_ptr<const DistanceMap> DistanceMap::Cached(const System *center, int maxCount, int maxDistance)
+{
+	Key key(center, nullptr, maxCount, maxDistance, 100, 0, false);
+	uint64_t generation = 0;
+	shared_ptr<const DistanceMap> result = FindCached(key, generation);
+	if(!result)
+	{
+		shared_ptr<DistanceMap> distance = make_shared<DistanceMap>(center, maxCount, maxDistance);
+		// The queue of edges is only needed while calculating the map.
+		distance->edges = priority_queue<Edge>();
+		result = distance;
+		AddCached(key, result, generation);
+	}
+	return result;
+}
+
+
+
+// Get a distance map of the path for the given ship to the given system,
+// calculating it only if it is not already cached.
+shared_ptr<const DistanceMap> DistanceMap::Cached(const Ship &ship, const System *destination)
+{
+	int hyperspaceFuel = 0;
+	int jumpFuel = 0;
+	GetDriveFuel(ship, hyperspaceFuel, jumpFuel);
+	Key key(destination, ship.GetSystem(), -1, -1, hyperspaceFuel, jumpFuel, true);
+	uint64_t generation = 0;
+	shared_ptr<const DistanceMap> result = FindCached(key, generation);
+	if(!result)
+	{
+		shared_ptr<DistanceMap> distance = make_shared<DistanceMap>(ship, destination);
+		distance->edges = priority_queue<Edge>();
+		result = distance;
+		if(!distance->isShipSpecific)
+			AddCached(key, result, generation);
+	}
+	return result;
+}
+
+
+
+// Forget all the cached maps.
+void DistanceMap::ClearCache()
+{
+	lock_guard<mutex> lock(cacheMutex);
+	cache.clear();
+	cacheIndex.clear();
+	++cacheGeneration;
+}
+
+
+
 // Get a set containing all the systems.
 set<const System *> DistanceMap::Systems() const
 {
@@ -146,12 +263,7 @@ void DistanceMap::Init(const System *center, const Ship *ship)
 	// hyperdrive capability and no jump drive.
 	if(ship)
 	{
-		hyperspaceFuel = ship->HyperdriveFuel();
-		jumpFuel = ship->JumpDriveFuel();
-		// If hyperjumps and non-hyper jumps cost the same amount, there is no
-		// need to check hyperjump paths at all.
-		if(hyperspaceFuel == jumpFuel)
-			hyperspaceFuel = 0.;
+		GetDriveFuel(*ship, hyperspaceFuel, jumpFuel);
 		
 		// If this ship has no mode of hyperspace travel, bail out.
 		if(!hyperspaceFuel && !jumpFuel)
@@ -195,8 +307,12 @@ void DistanceMap::Init(const System *center, const Ship *ship)
 					// the wormhole and both endpoint systems. (If this is a
 					// multi-stop wormhole, you may know about some paths that
 					// it takes but not others.)
-					if(ship && !object.GetPlanet()->IsAccessible(ship))
-						continue;
+					if(ship && !object.GetPlanet()->IsAccessible(nullptr))
+					{
+						isShipSpecific = true;
+						if(!object.GetPlanet()->IsAccessible(ship))
+							continue;
+					}
 					if(player && !player->HasVisited(object.GetPlanet()))
 						continue;
 					if(player && !(player->HasVisited(top.next) && player->HasVisited(link)))
@@ -14,6 +14,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #define DISTANCE_MAP_H_
 
 #include <map>
+#include <memory>
 #include <queue>
 #include <set>
 #include <utility>
@@ -43,6 +44,16 @@ public:
 	// pathfinding will stop once a path to the destination is found.
 	DistanceMap(const Ship &ship, const System *destination);
 	
+	// Get a distance map like those made by the constructors above, reusing a
+	// previously calculated one if nothing it depends on has changed. Maps that
+	// depend on what the player knows are not cached.
+	static std::shared_ptr<const DistanceMap> Cached(const System *center, int maxCount = -1, int maxDistance = -1);
+	static std::shared_ptr<const DistanceMap> Cached(const Ship &ship, const System *destination);
+	// Forget all the cached maps. This must be done whenever the links between
+	// systems or any wormholes change, or anything that changes how dangerous
+	// a system is: its fleets, or which governments are the player's enemies.
+	static void ClearCache();
+	
 	// Find out if the given system is reachable.
 	bool HasRoute(const System *system) const;
 	// Find out how many days away the given system is.
@@ -104,6 +115,9 @@ private:
 	int hyperspaceFuel = 100;
 	int jumpFuel = 0;
 	bool useWormholes = true;
+	// If this map uses a wormhole that only some ships can access, it cannot
+	// be reused for other ships with the same drives.
+	bool isShipSpecific = false;
 };
 
 
@@ -14,6 +14,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "Audio.h"
 #include "Effect.h"
+#include "Files.h"
 #include "FillShader.h"
 #include "Font.h"
 #include "FontSet.h"
@@ -35,19 +36,30 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Random.h"
 #include "RingShader.h"
 #include "Screen.h"
+#include "ShipHandle.h"
 #include "Sprite.h"
 #include "SpriteSet.h"
 #include "SpriteShader.h"
 #include "StarField.h"
 #include "StartConditions.h"
 #include "System.h"
+#include "WorkerPool.h"
+
+#include <SDL2/SDL.h>
 
 #include <algorithm>
 #include <cmath>
+#include <random>
 
 using namespace std;
 
 namespace {
+	// IDs of the ship and outfit attributes that the engine checks.
+	const int CARGO_SPACE = Outfit::AttributeID("cargo space");
+	const int FUEL_CAPACITY = Outfit::AttributeID("fuel capacity");
+	const int INSTALLABLE = Outfit::AttributeID("installable");
+	const int JUMP_DRIVE = Outfit::AttributeID("jump drive");
+	
 	int RadarType(const Ship &ship, int step)
 	{
 		if(ship.GetPersonality().IsTarget() && !ship.IsDestroyed())
@@ -68,12 +80,43 @@ namespace {
 			return Radar::HOSTILE;
 		return Radar::UNFRIENDLY;
 	}
+	
+	// If this is not empty, every flight is recorded to this file.
+	string recordingPath;
+	
+	// The state of a ship before it moved in this step.
+	class Movement {
+	public:
+		Ship *ship = nullptr;
+		bool isJump = false;
+		bool wasHere = false;
+		bool wasHyperspacing = false;
+		// Whether this ship can be moved in parallel with the others.
+		bool isAlone = false;
+		bool isAlive = true;
+	};
+	
+	// Number of objects in each block of work handed to a worker thread.
+	const int SHIP_BLOCK = 16;
+	const int PROJECTILE_BLOCK = 64;
+	const int EFFECT_BLOCK = 256;
+	
+	// Add the effects that each block of work created, in block order. The
+	// buffers are left empty, but keep their memory for the next step.
+	void AddEffects(vector<Effect> &effects, vector<vector<Effect>> &buffers)
+	{
+		for(vector<Effect> &buffer : buffers)
+		{
+			effects.insert(effects.end(), buffer.begin(), buffer.end());
+			buffer.clear();
+		}
+	}
 }
 
 
 
 Engine::Engine(PlayerInfo &player)
-	: player(player), ai(ships, asteroids.Minables(), flotsam),
+	: player(player), ai(ships, asteroids, flotsam),
 	shipCollisions(256, 32), cloakedCollisions(256, 32)
 {
 	zoom = Preferences::ViewZoom();
@@ -110,7 +153,7 @@ Engine::Engine(PlayerInfo &player)
 	
 	// Add all neighboring systems to the radar.
 	const System *targetSystem = flagship ? flagship->GetTargetSystem() : nullptr;
-	const set<const System *> &links = (flagship && flagship->Attributes().Get("jump drive")) ?
+	const set<const System *> &links = (flagship && flagship->Attributes().Get(JUMP_DRIVE)) ?
 		player.GetSystem()->Neighbors() : player.GetSystem()->Links();
 	for(const System *system : links)
 		radar[calcTickTock].AddPointer(
@@ -130,12 +173,66 @@ Engine::~Engine()
 	}
 	condition.notify_all();
 	calcThread.join();
+	
+	if(isRecording && !recording.IsEmpty())
+		recording.Save(recordingPath);
+}
+
+
+
+// Record every flight to the given file so that it can be replayed later.
+void Engine::SetRecordingPath(const string &path)
+{
+	recordingPath = path;
+}
+
+
+
+// Seed the random number generators of both this thread and the calculation
+// thread. The calculation thread is paused, so it picks up the new seed at the
+// start of its next step.
+void Engine::Seed(uint64_t seed)
+{
+	Random::Seed(seed);
+	this->seed = seed;
+	doSeed = true;
+}
+
+
+
+// Prepare to replay the given recording.
+void Engine::Replay(const Recording &recording)
+{
+	Seed(recording.Seed());
+	step = recording.StartStep();
 }
 
 
 
 void Engine::Place()
 {
+	if(!recordingPath.empty())
+	{
+		// Save the previous flight, if any, then start recording this one. The
+		// player's saved game was updated just before taking off, so a copy of
+		// it is exactly the state that this flight starts from.
+		if(isRecording && !recording.IsEmpty())
+			recording.Save(recordingPath);
+		string pilot;
+		if(!player.Identifier().empty())
+		{
+			size_t length = recordingPath.length();
+			bool isText = (length >= 4 && !recordingPath.compare(length - 4, 4, ".txt"));
+			pilot = recordingPath.substr(0, length - 4 * isText) + " pilot.txt";
+			Files::Copy(Files::Saves() + player.Identifier() + ".txt", pilot);
+		}
+		random_device device;
+		uint64_t newSeed = (static_cast<uint64_t>(device()) << 32) | device();
+		Seed(newSeed);
+		recording.Start(pilot, newSeed, step);
+		isRecording = true;
+	}
+	
 	ships.clear();
 	
 	EnterSystem();
@@ -255,6 +352,22 @@ void Engine::Place()
 
 
 
+// Place the given ships, plus the asteroids, in the player's current system
+// without the player entering it. This is used for scripted scenarios.
+void Engine::Place(const list<shared_ptr<Ship>> &newShips)
+{
+	ships = newShips;
+	projectiles.clear();
+	effects.clear();
+	flotsam.clear();
+	
+	asteroids.Clear();
+	if(player.GetSystem())
+		PlaceAsteroids(*player.GetSystem());
+}
+
+
+
 // Wait for the previous calculations (if any) to be done.
 void Engine::Wait()
 {
@@ -265,13 +378,49 @@ void Engine::Wait()
 
 
 
-// Begin the next step of calculations.
+// Perform all the work that can only be done while the calculation thread is
+// paused, reading the player's input from the keyboard.
 void Engine::Step(bool isActive)
 {
+	Command keys;
+	keys.ReadKeyboard();
+	bool shift = (SDL_GetModState() & KMOD_SHIFT);
+	
+	// Smoothly zoom in and out.
+	double newZoom = zoom;
+	if(isActive)
+	{
+		double zoomTarget = Preferences::ViewZoom();
+		if(newZoom < zoomTarget)
+			newZoom = min(zoomTarget, newZoom * 1.03);
+		else if(newZoom > zoomTarget)
+			newZoom = max(zoomTarget, newZoom * .97);
+	}
+	
+	Step(isActive, keys, shift, newZoom);
+}
+
+
+
+// Perform all the work that can only be done while the calculation thread is
+// paused, using the given player input.
+void Engine::Step(bool isActive, const Command &keys, bool shift, double newZoom)
+{
+	if(isRecording)
+		recording.Step(isActive, keys, shift, newZoom);
+	
 	events.swap(eventQueue);
 	eventQueue.clear();
 	
 	// The calculation thread is now paused, so it is safe to access things.
+	// That includes destroying any removed ships that nothing else refers to.
+	for(auto it = removedShips.begin(); it != removedShips.end(); )
+	{
+		if(it->use_count() == 1)
+			it = removedShips.erase(it);
+		else
+			++it;
+	}
 	const shared_ptr<Ship> flagship = player.FlagshipPtr();
 	const StellarObject *object = player.GetStellarObject();
 	if(object)
@@ -305,20 +454,12 @@ void Engine::Step(bool isActive)
 			--jumpCount;
 	}
 	ai.UpdateEvents(events);
-	ai.UpdateKeys(player, clickCommands, isActive && wasActive);
+	ai.UpdateKeys(player, keys, shift, clickCommands, isActive && wasActive);
 	wasActive = isActive;
 	Audio::Update(center);
 	
-	// Smoothly zoom in and out.
-	if(isActive)
-	{
-		double zoomTarget = Preferences::ViewZoom();
-		if(zoom < zoomTarget)
-			zoom = min(zoomTarget, zoom * 1.03);
-		else if(zoom > zoomTarget)
-			zoom = max(zoomTarget, zoom * .97);
-	}
-		
+	zoom = newZoom;
+	
 	// Draw a highlight to distinguish the flagship from other ships.
 	if(flagship && !flagship->IsDestroyed() && Preferences::Has("Highlight player's flagship"))
 	{
@@ -364,7 +505,7 @@ void Engine::Step(bool isActive)
 			else if(it.first->FiringFuel())
 			{
 				double remaining = flagship->Fuel()
-					* flagship->Attributes().Get("fuel capacity");
+					* flagship->Attributes().Get(FUEL_CAPACITY);
 				ammo.emplace_back(it.first,
 					remaining / it.first->FiringFuel());
 			}
@@ -453,7 +594,7 @@ void Engine::Step(bool isActive)
 	if(flagship)
 	{
 		info.SetBar("fuel", flagship->Fuel(),
-			flagship->Attributes().Get("fuel capacity") * .01);
+			flagship->Attributes().Get(FUEL_CAPACITY) * .01);
 		info.SetBar("energy", flagship->Energy());
 		info.SetBar("heat", flagship->Heat());
 		info.SetBar("shields", flagship->Shields());
@@ -619,6 +760,9 @@ void Engine::Step(bool isActive)
 // Begin the next step of calculations.
 void Engine::Go()
 {
+	if(isRecording)
+		recording.Go();
+	
 	{
 		unique_lock<mutex> lock(swapMutex);
 		++step;
@@ -636,6 +780,28 @@ const list<ShipEvent> &Engine::Events() const
 
 
 
+// Get statistics on the most recently calculated step, for benchmarking.
+int Engine::ShipCount() const
+{
+	return ships.size();
+}
+
+
+
+int Engine::ProjectileCount() const
+{
+	return projectiles.size();
+}
+
+
+
+int64_t Engine::CollisionTests() const
+{
+	return shipCollisions.Tests() + cloakedCollisions.Tests();
+}
+
+
+
 // Draw a frame.
 void Engine::Draw() const
 {
@@ -787,6 +953,9 @@ void Engine::Draw() const
 // Select the object the player clicked on.
 void Engine::Click(const Point &from, const Point &to, bool hasShift)
 {
+	if(isRecording)
+		recording.Click(from, to, hasShift);
+	
 	// First, see if this is a click on an escort icon.
 	doClickNextStep = true;
 	this->hasShift = hasShift;
@@ -799,6 +968,9 @@ void Engine::Click(const Point &from, const Point &to, bool hasShift)
 
 void Engine::RClick(const Point &point)
 {
+	if(isRecording)
+		recording.RClick(point);
+	
 	doClickNextStep = true;
 	hasShift = false;
 	isRightClick = true;
@@ -809,6 +981,9 @@ void Engine::RClick(const Point &point)
 
 void Engine::SelectGroup(int group, bool hasShift, bool hasControl)
 {
+	if(isRecording)
+		recording.SelectGroup(group, hasShift, hasControl);
+	
 	groupSelect = group;
 	this->hasShift = hasShift;
 	this->hasControl = hasControl;
@@ -869,14 +1044,7 @@ void Engine::EnterSystem()
 		}
 	
 	asteroids.Clear();
-	for(const System::Asteroid &a : system->Asteroids())
-	{
-		// Check whether this is a minable or an ordinary asteroid.
-		if(a.Type())
-			asteroids.Add(a.Type(), a.Count(), a.Energy(), system->AsteroidBelt());
-		else
-			asteroids.Add(a.Name(), a.Count(), a.Energy());
-	}
+	PlaceAsteroids(*system);
 	
 	// Place five seconds worth of fleets. Check for undefined fleets by not
 	// trying to create anything with no government set.
@@ -896,7 +1064,7 @@ void Engine::EnterSystem()
 			if(ship->IsParked())
 				continue;
 			
-			sum += .4 * sqrt(ship->Attributes().Get("cargo space")) - 1.8;
+			sum += .4 * sqrt(ship->Attributes().Get(CARGO_SPACE)) - 1.8;
 			for(const auto &it : ship->Weapons())
 				if(it.GetOutfit())
 				{
@@ -928,6 +1096,21 @@ void Engine::EnterSystem()
 
 
 
+// Add the asteroids and minables of the given system to the asteroid field.
+void Engine::PlaceAsteroids(const System &system)
+{
+	for(const System::Asteroid &a : system.Asteroids())
+	{
+		// Check whether this is a minable or an ordinary asteroid.
+		if(a.Type())
+			asteroids.Add(a.Type(), a.Count(), a.Energy(), system.AsteroidBelt());
+		else
+			asteroids.Add(a.Name(), a.Count(), a.Energy());
+	}
+}
+
+
+
 // Thread entry point.
 void Engine::ThreadEntryPoint()
 {
@@ -942,8 +1125,11 @@ void Engine::ThreadEntryPoint()
 				break;
 		}
 		
-		// Do all the calculations.
+		// Do all the calculations. Ships may be destroyed on the main thread
+		// only while this thread is not following handles to them.
+		ShipHandle::BeginFollowing();
 		CalculateStep();
+		ShipHandle::EndFollowing();
 		
 		{
 			unique_lock<mutex> lock(swapMutex);
@@ -959,6 +1145,14 @@ void Engine::CalculateStep()
 {
 	FrameTimer loadTimer;
 	
+	// Random numbers are generated separately in each thread, so this thread
+	// must apply any new seed itself.
+	if(doSeed)
+	{
+		Random::Seed(seed);
+		doSeed = false;
+	}
+	
 	// Clear the list of objects to draw.
 	draw[calcTickTock].Clear(step, zoom);
 	radar[calcTickTock].Clear();
@@ -966,6 +1160,11 @@ void Engine::CalculateStep()
 	if(!player.GetSystem())
 		return;
 	
+	// A step is calculated in stages, each of which must be finished before the
+	// next begins. Within a stage, any work that involves only one object at a
+	// time is spread across the worker threads. Everything else is done here,
+	// in a fixed order, so the results never depend on the number of threads.
+	
 	// Now, all the ships must decide what they are doing next.
 	ai.Step(player);
 	const Ship *flagship = player.Flagship();
@@ -975,53 +1174,7 @@ void Engine::CalculateStep()
 	// them fire, or their turrets will be targeting where a given ship was
 	// instead of where it is now. This is also where ships get deleted, and
 	// where they may create explosions if they are dying.
-	for(auto it = ships.begin(); it != ships.end(); )
-	{
-		bool isJump = (*it)->IsUsingJumpDrive();
-		bool wasHere = (flagship && (*it)->GetSystem() == flagship->GetSystem());
-		bool wasHyperspacing = (*it)->IsHyperspacing();
-		// Give the ship the list of effects so that it can draw explosions,
-		// ion sparks, jump drive flashes, etc.
-		if(!(*it)->Move(effects, flotsam))
-		{
-			// If Move() returns false, it means the ship should be removed from
-			// play. That may be because it was destroyed, because it is an
-			// ordinary ship that has been out of system for long enough to be
-			// "forgotten," or because it is a fighter that just docked with its
-			// mothership. Report it destroyed if that's really what happened:
-			if((*it)->IsDestroyed())
-				eventQueue.emplace_back(nullptr, *it, ShipEvent::DESTROY);
-			it = ships.erase(it);
-		}
-		else
-		{
-			// Check if we need to play sounds for a ship jumping in or out of
-			// the system. Make no sound if it entered via wormhole.
-			if(&**it != flagship && (*it)->Zoom() == 1.)
-			{
-				// Did this ship just begin hyperspacing?
-				if(wasHere && !wasHyperspacing && (*it)->IsHyperspacing())
-					Audio::Play(
-						Audio::Get(isJump ? "jump out" : "hyperdrive out"),
-						(*it)->Position());
-				
-				// Did this ship just jump into the player's system?
-				if(!wasHere && flagship && (*it)->GetSystem() == flagship->GetSystem())
-					Audio::Play(
-						Audio::Get(isJump ? "jump in" : "hyperdrive in"),
-						(*it)->Position());
-			}
-			
-			// Boarding:
-			bool autoPlunder = !(*it)->GetGovernment()->IsPlayer();
-			shared_ptr<Ship> victim = (*it)->Board(autoPlunder);
-			if(victim)
-				eventQueue.emplace_back(*it, victim,
-					(*it)->GetGovernment()->IsEnemy(victim->GetGovernment()) ?
-						ShipEvent::BOARD : ShipEvent::ASSIST);
-			++it;
-		}
-	}
+	MoveShips();
 	
 	if(!wasHyperspacing && flagship && flagship->IsEnteringHyperspace())
 		Audio::Play(Audio::Get(flagship->IsUsingJumpDrive() ? "jump drive" : "hyperdrive"));
@@ -1041,21 +1194,7 @@ void Engine::CalculateStep()
 	}
 	
 	// Populate the collision detection set.
-	shipCollisions.Clear(step);
-	cloakedCollisions.Clear(step);
-	for(const shared_ptr<Ship> &it : ships)
-		if(it->GetSystem() == player.GetSystem() && it->Zoom() == 1.)
-		{
-			// If this ship is able to collide with projectiles, add it to the
-			// collision detection set.
-			if(it->Cloaking() < 1.)
-				shipCollisions.Add(*it);
-			else
-				cloakedCollisions.Add(*it);
-		}
-	// Get the ship collision set ready to query.
-	shipCollisions.Finish();
-	cloakedCollisions.Finish();
+	FillCollisionSets();
 	
 	// Draw the planets.
 	Point newCenter = center;
@@ -1107,7 +1246,7 @@ void Engine::CalculateStep()
 	
 	// Add all neighboring systems to the radar.
 	const System *targetSystem = flagship ? flagship->GetTargetSystem() : nullptr;
-	const set<const System *> &links = (flagship && flagship->Attributes().Get("jump drive")) ?
+	const set<const System *> &links = (flagship && flagship->Attributes().Get(JUMP_DRIVE)) ?
 		player.GetSystem()->Neighbors() : player.GetSystem()->Links();
 	for(const System *system : links)
 		radar[calcTickTock].AddPointer(
@@ -1126,18 +1265,7 @@ void Engine::CalculateStep()
 	// result in a "die" effect or a sub-munition being created. We could not
 	// move the projectiles before this because some of them are homing and need
 	// to know the current positions of the ships.
-	list<Projectile> newProjectiles;
-	for(auto it = projectiles.begin(); it != projectiles.end(); )
-	{
-		if(!it->Move(effects))
-		{
-			it->MakeSubmunitions(newProjectiles);
-			it = projectiles.erase(it);
-		}
-		else
-			++it;
-	}
-	projectiles.splice(projectiles.end(), newProjectiles);
+	MoveProjectiles();
 	
 	// Move the flotsam, which should be drawn underneath the ships.
 	for(auto it = flotsam.begin(); it != flotsam.end(); )
@@ -1149,7 +1277,8 @@ void Engine::CalculateStep()
 		}
 		
 		Ship *collector = nullptr;
-		for(Body *body : shipCollisions.Circle((*it)->Position(), 5.))
+		shipCollisions.Circle((*it)->Position(), 5., inRange);
+		for(Body *body : inRange)
 		{
 			Ship *ship = reinterpret_cast<Ship *>(body);
 			if(!ship->CannotAct() && ship != (*it)->Source() && ship->Cargo().Free() >= (*it)->UnitSize())
@@ -1177,7 +1306,7 @@ void Engine::CalculateStep()
 				amount = collector->Cargo().Add(outfit, (*it)->Count());
 				if(!name.empty())
 				{
-					if(outfit->Get("installable") < 0.)
+					if(outfit->Get(INSTALLABLE) < 0.)
 					{
 						commodity = outfit->Name();
 						player.Harvest(outfit);
@@ -1339,74 +1468,368 @@ void Engine::CalculateStep()
 	else if(!hasHostiles)
 		hadHostiles = false;
 	
-	// Collision detection:
-	if(grudgeTime)
-		--grudgeTime;
-	for(Projectile &projectile : projectiles)
+	// Collision detection: first find what every projectile hits, then apply
+	// the damage.
+	FindCollisions();
+	DoCollisions(hasAntiMissile);
+	
+	// Finally, draw all the effects, and then move them (because their motion
+	// is not dependent on anything else, and this way we do all the work on
+	// them in a single place.
+	MoveEffects();
+	
+	// Add incoming ships.
+	for(const System::FleetProbability &fleet : player.GetSystem()->Fleets())
+		if(!Random::Int(fleet.Period()))
+		{
+			const Government *gov = fleet.Get()->GetGovernment();
+			if(!gov)
+				continue;
+			
+			int64_t enemyStrength = 0;
+			for(const auto &it : strength)
+				if(gov->IsEnemy(it.first))
+					enemyStrength += it.second;
+			if(enemyStrength && strength[gov] > 2 * enemyStrength)
+				continue;
+			
+			fleet.Get()->Enter(*player.GetSystem(), ships);
+		}
+	if(!Random::Int(36000) && !player.GetSystem()->Links().empty())
 	{
-		// The asteroids can collide with projectiles, the same as any other
-		// object. If the asteroid turns out to be closer than the ship, it
-		// shields the ship (unless the projectile has a blast radius).
-		Point hitVelocity;
-		double closestHit = 1.;
-		shared_ptr<Ship> hit;
-		const Government *gov = projectile.GetGovernment();
+		// Loop through all persons once to see if there are any who can enter
+		// this system.
+		int sum = 0;
+		for(const auto &it : GameData::Persons())
+			sum += it.second.Frequency(player.GetSystem());
 		
-		// If this "projectile" is a ship explosion, it always explodes.
-		if(!gov)
-			closestHit = 0.;
-		else if(projectile.GetWeapon().IsPhasing() && projectile.Target())
+		if(sum)
 		{
-			// "Phasing" projectiles that have a target will never hit any other ship.
-			shared_ptr<Ship> target = projectile.TargetPtr();
-			if(target && target->GetSystem() == player.GetSystem()
-					&& target->Zoom() == 1. && target->Cloaking() < 1.)
+			// Adjustment factor: special persons will appear once every ten
+			// minutes, but much less frequently if the game only specifies a
+			// few of them. This way, they will become more common as I add
+			// more, without needing to change the 10-minute constant above.
+			sum = Random::Int(sum + 1000);
+			for(const auto &it : GameData::Persons())
 			{
-				Point offset = projectile.Position() - target->Position();
-				double range = target->GetMask(step).Collide(offset, projectile.Velocity(), target->Facing());
-				if(range < 1.)
+				const Person &person = it.second;
+				sum -= person.Frequency(player.GetSystem());
+				if(sum < 0)
 				{
-					closestHit = range;
-					hit = target;
+					shared_ptr<Ship> ship = person.GetShip();
+					ship->Recharge();
+					ship->SetName(it.first);
+					ship->SetGovernment(person.GetGovernment());
+					ship->SetPersonality(person.GetPersonality());
+					ship->SetHail(person.GetHail());
+					Fleet::Enter(*player.GetSystem(), *ship);
+					
+					ships.push_front(ship);
+					
+					break;
 				}
 			}
 		}
+	}
+	
+	// Occasionally have some ship hail you.
+	if(!Random::Int(600) && !player.IsDead() && !ships.empty())
+	{
+		shared_ptr<Ship> source;
+		unsigned i = Random::Int(ships.size());
+		for(const shared_ptr<Ship> &it : ships)
+			if(!i--)
+			{
+				source = it;
+				break;
+			}
+		if(source->GetGovernment() && !source->GetGovernment()->IsPlayer()
+				&& !source->IsDisabled() && source->Crew() && source->Cloaking() < 1.)
+		{
+			string message = source->GetHail();
+			if(!message.empty() && source->GetSystem() == player.GetSystem())
+			{
+				// If this ship has no name, show its model name instead.
+				string tag;
+				const string &gov = source->GetGovernment()->GetName();
+				if(!source->Name().empty())
+					tag = gov + " " + source->Noun() + " \"" + source->Name() + "\": ";
+				else
+					tag = source->ModelName() + " (" + gov + "): ";
+				Messages::Add(tag + message);
+			}
+		}
+	}
+	
+	// Keep track of how much of the CPU time we are using.
+	loadSum += loadTimer.Time();
+	if(++loadCount == 60)
+	{
+		load = loadSum;
+		loadSum = 0.;
+		loadCount = 0;
+	}
+}
+
+
+
+// Move all the ships, and remove any that are destroyed or have left play.
+void Engine::MoveShips()
+{
+	const Ship *flagship = player.Flagship();
+	
+	// Remember what each ship was doing before it moved.
+	vector<Movement> moves(ships.size());
+	auto move = moves.begin();
+	for(const shared_ptr<Ship> &it : ships)
+	{
+		move->ship = it.get();
+		move->isJump = it->IsUsingJumpDrive();
+		move->wasHere = (flagship && it->GetSystem() == flagship->GetSystem());
+		move->wasHyperspacing = it->IsHyperspacing();
+		move->isAlone = it->MovesAlone();
+		++move;
+	}
+	
+	// Most ships do not read or change any other ship while they move, so they
+	// can all be moved at once. Each block of them creates its own effects and
+	// flotsam, which are added in block order no matter which thread did what.
+	// Give the ships the list of effects so that they can draw explosions,
+	// ion sparks, jump drive flashes, etc.
+	unsigned blocks = WorkerPool::Blocks(moves.size(), SHIP_BLOCK);
+	if(newEffects.size() < blocks)
+		newEffects.resize(blocks);
+	newFlotsam.resize(blocks);
+	WorkerPool::RunSeeded(moves.size(), SHIP_BLOCK, [this, &moves](int start, int end)
+	{
+		vector<Effect> &blockEffects = newEffects[start / SHIP_BLOCK];
+		list<shared_ptr<Flotsam>> &blockFlotsam = newFlotsam[start / SHIP_BLOCK];
+		for(int i = start; i < end; ++i)
+			if(moves[i].isAlone)
+				moves[i].isAlive = moves[i].ship->Move(blockEffects, blockFlotsam);
+	});
+	AddEffects(effects, newEffects);
+	for(list<shared_ptr<Flotsam>> &it : newFlotsam)
+		flotsam.splice(flotsam.end(), it);
+	
+	// Any ships that are boarding or following their parents are moved after
+	// all the others, one at a time.
+	for(Movement &it : moves)
+		if(!it.isAlone)
+			it.isAlive = it.ship->Move(effects, flotsam);
+	
+	move = moves.begin();
+	for(auto it = ships.begin(); it != ships.end(); ++move)
+	{
+		if(!move->isAlive)
+		{
+			// If Move() returns false, it means the ship should be removed from
+			// play. That may be because it was destroyed, because it is an
+			// ordinary ship that has been out of system for long enough to be
+			// "forgotten," or because it is a fighter that just docked with its
+			// mothership. Report it destroyed if that's really what happened:
+			if((*it)->IsDestroyed())
+				eventQueue.emplace_back(nullptr, *it, ShipEvent::DESTROY);
+			auto next = it;
+			++next;
+			removedShips.splice(removedShips.end(), ships, it);
+			it = next;
+		}
 		else
 		{
-			double triggerRadius = projectile.GetWeapon().TriggerRadius();
-			if(triggerRadius)
+			// Check if we need to play sounds for a ship jumping in or out of
+			// the system. Make no sound if it entered via wormhole.
+			if(&**it != flagship && (*it)->Zoom() == 1.)
 			{
-				// Check if something triggered this projectile.
-				for(const Body *body : shipCollisions.Circle(projectile.Position(), triggerRadius))
-					if(body == projectile.Target() || gov->IsEnemy(body->GetGovernment()))
-					{
-						closestHit = 0.;
-						break;
-					}
+				// Did this ship just begin hyperspacing?
+				if(move->wasHere && !move->wasHyperspacing && (*it)->IsHyperspacing())
+					Audio::Play(
+						Audio::Get(move->isJump ? "jump out" : "hyperdrive out"),
+						(*it)->Position());
+				
+				// Did this ship just jump into the player's system?
+				if(!move->wasHere && flagship && (*it)->GetSystem() == flagship->GetSystem())
+					Audio::Play(
+						Audio::Get(move->isJump ? "jump in" : "hyperdrive in"),
+						(*it)->Position());
 			}
-			if(closestHit > 0.)
+			(*it)->ForgetDestroyedTarget();
+			
+			// Boarding:
+			bool autoPlunder = !(*it)->GetGovernment()->IsPlayer();
+			shared_ptr<Ship> victim = (*it)->Board(autoPlunder);
+			if(victim)
+				eventQueue.emplace_back(*it, victim,
+					(*it)->GetGovernment()->IsEnemy(victim->GetGovernment()) ?
+						ShipEvent::BOARD : ShipEvent::ASSIST);
+			++it;
+		}
+	}
+}
+
+
+
+// Add all the ships in the player's system to the collision detection sets.
+void Engine::FillCollisionSets()
+{
+	shipCollisions.Clear(step);
+	cloakedCollisions.Clear(step);
+	for(const shared_ptr<Ship> &it : ships)
+		if(it->GetSystem() == player.GetSystem() && it->Zoom() == 1.)
+		{
+			// If this ship is able to collide with projectiles, add it to the
+			// collision detection set.
+			if(it->Cloaking() < 1.)
+				shipCollisions.Add(*it);
+			else
+				cloakedCollisions.Add(*it);
+		}
+	// Get the ship collision set ready to query.
+	shipCollisions.Finish();
+	cloakedCollisions.Finish();
+}
+
+
+
+// Move all the projectiles, and remove any that have died.
+void Engine::MoveProjectiles()
+{
+	// Projectiles only read the positions of the ships they are homing in on,
+	// and ships do not move during this stage, so they can all be moved at once.
+	isAlive.resize(projectiles.size());
+	unsigned blocks = WorkerPool::Blocks(projectiles.size(), PROJECTILE_BLOCK);
+	if(newEffects.size() < blocks)
+		newEffects.resize(blocks);
+	WorkerPool::RunSeeded(projectiles.size(), PROJECTILE_BLOCK, [this](int start, int end)
+	{
+		vector<Effect> &blockEffects = newEffects[start / PROJECTILE_BLOCK];
+		for(int i = start; i < end; ++i)
+			isAlive[i] = projectiles[i].Move(blockEffects);
+	});
+	AddEffects(effects, newEffects);
+	
+	// Remove the dead projectiles in a single pass, shifting the live ones down
+	// to fill the gaps so that they stay in the same order.
+	vector<Projectile> newProjectiles;
+	auto out = projectiles.begin();
+	for(auto it = projectiles.begin(); it != projectiles.end(); ++it)
+	{
+		if(!isAlive[it - projectiles.begin()])
+			it->MakeSubmunitions(newProjectiles);
+		else
+		{
+			if(out != it)
+				*out = move(*it);
+			++out;
+		}
+	}
+	projectiles.erase(out, projectiles.end());
+	projectiles.insert(projectiles.end(), newProjectiles.begin(), newProjectiles.end());
+}
+
+
+
+// Find out what each projectile hits. This only reads the projectiles, ships,
+// and asteroids, so the projectiles can be checked in parallel.
+void Engine::FindCollisions()
+{
+	collisions.clear();
+	collisions.resize(projectiles.size());
+	blockInRange.resize(WorkerPool::Blocks(projectiles.size(), PROJECTILE_BLOCK));
+	WorkerPool::Run(projectiles.size(), PROJECTILE_BLOCK, [this](int start, int end)
+	{
+		vector<Body *> &inRange = blockInRange[start / PROJECTILE_BLOCK];
+		for(int i = start; i < end; ++i)
+		{
+			const Projectile &projectile = projectiles[i];
+			Collision &collision = collisions[i];
+			const Government *gov = projectile.GetGovernment();
+			
+			// The asteroids can collide with projectiles, the same as any other
+			// object. If the asteroid turns out to be closer than the ship, it
+			// shields the ship (unless the projectile has a blast radius).
+			
+			// If this "projectile" is a ship explosion, it always explodes.
+			if(!gov)
+				collision.closestHit = 0.;
+			else if(projectile.GetWeapon().IsPhasing() && projectile.Target())
 			{
-				// If the projectile was not triggered, check if it hit a ship.
-				Ship *ship = reinterpret_cast<Ship *>(shipCollisions.Line(projectile, &closestHit));
-				if(ship)
+				// "Phasing" projectiles that have a target will never hit any other ship.
+				shared_ptr<Ship> target = projectile.TargetPtr();
+				if(target && target->GetSystem() == player.GetSystem()
+						&& target->Zoom() == 1. && target->Cloaking() < 1.)
 				{
-					hit = ship->shared_from_this();
-					hitVelocity = ship->Velocity();
+					Point offset = projectile.Position() - target->Position();
+					double range = target->GetMask(step).Collide(offset, projectile.Velocity(), target->Facing());
+					if(range < 1.)
+					{
+						collision.closestHit = range;
+						collision.ship = target.get();
+					}
 				}
 			}
-			// "Phasing" projectiles can pass through asteroids.
-			if(!projectile.GetWeapon().IsPhasing())
+			else
 			{
-				// Check if the projectile hits an asteroid that is closer than
-				// the ship that it hit (if any).
-				double closestAsteroid = asteroids.Collide(projectile, step, closestHit, &hitVelocity);
-				if(closestAsteroid < closestHit)
+				double triggerRadius = projectile.GetWeapon().TriggerRadius();
+				if(triggerRadius)
+				{
+					// Check if something triggered this projectile.
+					shipCollisions.Circle(projectile.Position(), triggerRadius, inRange);
+					for(const Body *body : inRange)
+						if(body == projectile.Target() || gov->IsEnemy(body->GetGovernment()))
+						{
+							collision.closestHit = 0.;
+							break;
+						}
+				}
+				if(collision.closestHit > 0.)
+				{
+					// If the projectile was not triggered, check if it hit a ship.
+					Ship *ship = reinterpret_cast<Ship *>(shipCollisions.Line(projectile, &collision.closestHit));
+					if(ship)
+					{
+						collision.ship = ship;
+						collision.hitVelocity = ship->Velocity();
+					}
+				}
+				// "Phasing" projectiles can pass through asteroids.
+				if(!projectile.GetWeapon().IsPhasing())
 				{
-					closestHit = closestAsteroid;
-					hit = nullptr;
+					// Check if the projectile hits an asteroid that is closer than
+					// the ship that it hit (if any).
+					double closestAsteroid = asteroids.Collide(projectile, step,
+						collision.closestHit, &collision.hitVelocity, &collision.minable);
+					if(closestAsteroid < collision.closestHit)
+					{
+						collision.closestHit = closestAsteroid;
+						collision.ship = nullptr;
+					}
 				}
 			}
 		}
+	});
+}
+
+
+
+// Apply the collisions that were found, in the same order as the projectiles,
+// so that the results do not depend on how the search was divided up.
+void Engine::DoCollisions(const vector<Ship *> &hasAntiMissile)
+{
+	if(grudgeTime)
+		--grudgeTime;
+	for(size_t i = 0; i < projectiles.size(); ++i)
+	{
+		Projectile &projectile = projectiles[i];
+		const Collision &collision = collisions[i];
+		double closestHit = collision.closestHit;
+		const Point &hitVelocity = collision.hitVelocity;
+		shared_ptr<Ship> hit;
+		if(collision.ship)
+			hit = collision.ship->shared_from_this();
+		if(collision.minable)
+			collision.minable->TakeDamage(projectile);
+		const Government *gov = projectile.GetGovernment();
 		
 		if(closestHit < 1.)
 		{
@@ -1423,7 +1846,8 @@ void Engine::CalculateStep()
 				// Even friendly ships can be hit by the blast, unless it is a
 				// "safe" weapon.
 				Point hitPos = projectile.Position() + closestHit * projectile.Velocity();
-				for(Body *body : shipCollisions.Circle(hitPos, blastRadius))
+				shipCollisions.Circle(hitPos, blastRadius, inRange);
+				for(Body *body : inRange)
 				{
 					if(isSafe && projectile.Target() != body
 							&& !projectile.GetGovernment()->IsEnemy(body->GetGovernment()))
@@ -1436,7 +1860,8 @@ void Engine::CalculateStep()
 							projectile.GetGovernment(), ship, eventType);
 				}
 				// Cloaked ships can be hit be a blast, too.
-				for(Body *body : cloakedCollisions.Circle(hitPos, blastRadius))
+				cloakedCollisions.Circle(hitPos, blastRadius, inRange);
+				for(Body *body : inRange)
 				{
 					if(isSafe && projectile.Target() != body
 							&& !projectile.GetGovernment()->IsEnemy(body->GetGovernment()))
@@ -1487,111 +1912,34 @@ void Engine::CalculateStep()
 		Point relativeVelocity = projectile.Velocity() - projectile.Unit() * innateVelocity;
 		draw[calcTickTock].AddProjectile(projectile, relativeVelocity, closestHit);
 	}
+}
+
+
+
+// Draw all the effects, then move them and remove any that have expired.
+void Engine::MoveEffects()
+{
+	for(const Effect &effect : effects)
+		draw[calcTickTock].AddUnblurred(effect);
 	
-	// Finally, draw all the effects, and then move them (because their motion
-	// is not dependent on anything else, and this way we do all the work on
-	// them in a single place.
-	for(auto it = effects.begin(); it != effects.end(); )
-	{
-		draw[calcTickTock].AddUnblurred(*it);
-		
-		if(!it->Move())
-			it = effects.erase(it);
-		else
-			++it;
-	}
-	
-	// Add incoming ships.
-	for(const System::FleetProbability &fleet : player.GetSystem()->Fleets())
-		if(!Random::Int(fleet.Period()))
-		{
-			const Government *gov = fleet.Get()->GetGovernment();
-			if(!gov)
-				continue;
-			
-			int64_t enemyStrength = 0;
-			for(const auto &it : strength)
-				if(gov->IsEnemy(it.first))
-					enemyStrength += it.second;
-			if(enemyStrength && strength[gov] > 2 * enemyStrength)
-				continue;
-			
-			fleet.Get()->Enter(*player.GetSystem(), ships);
-		}
-	if(!Random::Int(36000) && !player.GetSystem()->Links().empty())
-	{
-		// Loop through all persons once to see if there are any who can enter
-		// this system.
-		int sum = 0;
-		for(const auto &it : GameData::Persons())
-			sum += it.second.Frequency(player.GetSystem());
-		
-		if(sum)
-		{
-			// Adjustment factor: special persons will appear once every ten
-			// minutes, but much less frequently if the game only specifies a
-			// few of them. This way, they will become more common as I add
-			// more, without needing to change the 10-minute constant above.
-			sum = Random::Int(sum + 1000);
-			for(const auto &it : GameData::Persons())
-			{
-				const Person &person = it.second;
-				sum -= person.Frequency(player.GetSystem());
-				if(sum < 0)
-				{
-					shared_ptr<Ship> ship = person.GetShip();
-					ship->Recharge();
-					ship->SetName(it.first);
-					ship->SetGovernment(person.GetGovernment());
-					ship->SetPersonality(person.GetPersonality());
-					ship->SetHail(person.GetHail());
-					Fleet::Enter(*player.GetSystem(), *ship);
-					
-					ships.push_front(ship);
-					
-					break;
-				}
-			}
-		}
-	}
-	
-	// Occasionally have some ship hail you.
-	if(!Random::Int(600) && !player.IsDead() && !ships.empty())
+	isAlive.resize(effects.size());
+	WorkerPool::Run(effects.size(), EFFECT_BLOCK, [this](int start, int end)
 	{
-		shared_ptr<Ship> source;
-		unsigned i = Random::Int(ships.size());
-		for(const shared_ptr<Ship> &it : ships)
-			if(!i--)
-			{
-				source = it;
-				break;
-			}
-		if(source->GetGovernment() && !source->GetGovernment()->IsPlayer()
-				&& !source->IsDisabled() && source->Crew() && source->Cloaking() < 1.)
+		for(int i = start; i < end; ++i)
+			isAlive[i] = effects[i].Move();
+	});
+	
+	// Remove the expired effects in a single pass, shifting the others down to
+	// fill the gaps so that they stay in the same order.
+	auto out = effects.begin();
+	for(auto it = effects.begin(); it != effects.end(); ++it)
+		if(isAlive[it - effects.begin()])
 		{
-			string message = source->GetHail();
-			if(!message.empty() && source->GetSystem() == player.GetSystem())
-			{
-				// If this ship has no name, show its model name instead.
-				string tag;
-				const string &gov = source->GetGovernment()->GetName();
-				if(!source->Name().empty())
-					tag = gov + " " + source->Noun() + " \"" + source->Name() + "\": ";
-				else
-					tag = source->ModelName() + " (" + gov + "): ";
-				Messages::Add(tag + message);
-			}
+			if(out != it)
+				*out = *it;
+			++out;
 		}
-	}
-	
-	// Keep track of how much of the CPU time we are using.
-	loadSum += loadTimer.Time();
-	if(++loadCount == 60)
-	{
-		load = loadSum;
-		loadSum = 0.;
-		loadCount = 0;
-	}
+	effects.erase(out, effects.end());
 }
 
 
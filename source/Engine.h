@@ -24,20 +24,24 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Point.h"
 #include "Projectile.h"
 #include "Radar.h"
+#include "Recording.h"
 #include "Rectangle.h"
 #include "Ship.h"
 #include "ShipEvent.h"
 
 #include <condition_variable>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
 class Government;
 class Outfit;
 class PlayerInfo;
+class System;
 
 
 
@@ -53,19 +57,42 @@ public:
 	explicit Engine(PlayerInfo &player);
 	~Engine();
 	
+	// Record every flight, from each call to Place() until the next one, to the
+	// given file so that it can be replayed later. Only the most recent flight
+	// is kept. The file is written when the next flight begins or when the
+	// engine is destroyed.
+	static void SetRecordingPath(const std::string &path);
+	// Seed the random number generators of both this thread and the calculation
+	// thread, so that the simulation can be repeated exactly.
+	void Seed(uint64_t seed);
+	// Prepare to replay the given recording by restoring the random seed and
+	// step count that it started with. This must be called before Place().
+	void Replay(const Recording &recording);
+	
 	// Place all the player's ships, and "enter" the system the player is in.
 	void Place();
+	// Place the given ships, plus the asteroids, in the player's current system
+	// without the player entering it. This is used for scripted scenarios.
+	void Place(const std::list<std::shared_ptr<Ship>> &newShips);
 	
 	// Wait for the previous calculations (if any) to be done.
 	void Wait();
 	// Perform all the work that can only be done while the calculation thread
 	// is paused (for thread safety reasons).
 	void Step(bool isActive);
+	// Step using the given player input instead of reading the keyboard and the
+	// zoom preference (e.g. when replaying a recording).
+	void Step(bool isActive, const Command &keys, bool shift, double newZoom);
 	// Begin the next step of calculations.
 	void Go();
 	
 	// Get any special events that happened in this step.
 	const std::list<ShipEvent> &Events() const;
+	// Get statistics on the most recently calculated step, for benchmarking.
+	// These may only be called while the calculation thread is paused.
+	int ShipCount() const;
+	int ProjectileCount() const;
+	int64_t CollisionTests() const;
 	
 	// Draw a frame.
 	void Draw() const;
@@ -78,9 +105,18 @@ public:
 	
 private:
 	void EnterSystem();
+	void PlaceAsteroids(const System &system);
 	
 	void ThreadEntryPoint();
 	void CalculateStep();
+	// Stages of calculating a step. Each stage may spread the work that only
+	// involves one object at a time across the worker threads.
+	void MoveShips();
+	void FillCollisionSets();
+	void MoveProjectiles();
+	void FindCollisions();
+	void DoCollisions(const std::vector<Ship *> &hasAntiMissile);
+	void MoveEffects();
 	void AddSprites(const Ship &ship);
 	
 	void DoGrudge(const std::shared_ptr<Ship> &target, const Government *attacker);
@@ -107,16 +143,40 @@ private:
 		double angle;
 	};
 	
+	// What a projectile hit in this step, and how far along its path.
+	class Collision {
+	public:
+		double closestHit = 1.;
+		Point hitVelocity;
+		Ship *ship = nullptr;
+		Minable *minable = nullptr;
+	};
+	
 	
 private:
 	PlayerInfo &player;
 	
 	std::list<std::shared_ptr<Ship>> ships;
-	std::list<Projectile> projectiles;
+	// Ships that have been removed from play. Handles to them may still be
+	// followed on the calculation thread, so they are only allowed to be
+	// destroyed while it is paused.
+	std::list<std::shared_ptr<Ship>> removedShips;
+	std::vector<Projectile> projectiles;
 	std::list<std::shared_ptr<Flotsam>> flotsam;
-	std::list<Effect> effects;
+	std::vector<Effect> effects;
 	AsteroidField asteroids;
 	
+	// Scratch space for the stages of each step. This is kept from one step to
+	// the next so that it does not need to be allocated again.
+	std::vector<std::vector<Effect>> newEffects;
+	std::vector<std::list<std::shared_ptr<Flotsam>>> newFlotsam;
+	std::vector<char> isAlive;
+	std::vector<Collision> collisions;
+	// The objects found by a collision set's Circle() query. Each block of
+	// projectiles has its own vector while collisions are being found.
+	std::vector<Body *> inRange;
+	std::vector<std::vector<Body *>> blockInRange;
+	
 	AI ai;
 	
 	std::thread calcThread;
@@ -176,6 +236,12 @@ private:
 	
 	double zoom = 1.;
 	
+	// If the random seed was changed, the calculation thread must be reseeded.
+	bool doSeed = false;
+	uint64_t seed = 0;
+	bool isRecording = false;
+	Recording recording;
+	
 	double load = 0.;
 	int loadCount = 0;
 	double loadSum = 0.;
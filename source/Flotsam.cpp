@@ -91,7 +91,7 @@ void Flotsam::Place(const Body &source, const Point &dv)
 
 
 // Move the object one time-step forward.
-bool Flotsam::Move(list<Effect> &effects)
+bool Flotsam::Move(vector<Effect> &effects)
 {
 	position += velocity;
 	angle += spin;
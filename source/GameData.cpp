@@ -16,9 +16,11 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Color.h"
 #include "Command.h"
 #include "Conversation.h"
+#include "DataCache.h"
 #include "DataFile.h"
 #include "DataNode.h"
 #include "DataWriter.h"
+#include "DistanceMap.h"
 #include "Effect.h"
 #include "Files.h"
 #include "FillShader.h"
@@ -29,6 +31,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "GameEvent.h"
 #include "Government.h"
 #include "Interface.h"
+#include "JumpTable.h"
 #include "LineShader.h"
 #include "Minable.h"
 #include "Mission.h"
@@ -51,10 +54,13 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "StarField.h"
 #include "StartConditions.h"
 #include "System.h"
+#include "WorkerPool.h"
 
 #include <algorithm>
+#include <exception>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -92,6 +98,7 @@ namespace {
 	Set<Sale<Outfit>> defaultOutfitSales;
 	
 	Politics politics;
+	JumpTable jumpTable;
 	StartConditions startConditions;
 	
 	Trade trade;
@@ -122,6 +129,7 @@ void GameData::BeginLoad(const char * const *argv)
 	bool printShips = false;
 	bool printWeapons = false;
 	bool debugMode = false;
+	bool useDataCache = false;
 	for(const char * const *it = argv + 1; *it; ++it)
 	{
 		if((*it)[0] == '-')
@@ -133,6 +141,8 @@ void GameData::BeginLoad(const char * const *argv)
 				printWeapons = true;
 			if(arg == "-d" || arg == "--debug")
 				debugMode = true;
+			if(arg == "--data-cache")
+				useDataCache = true;
 			continue;
 		}
 	}
@@ -161,18 +171,63 @@ void GameData::BeginLoad(const char * const *argv)
 	// Generate a catalog of music files.
 	Music::Init(sources);
 	
+	vector<string> dataFiles;
 	for(const string &source : sources)
 	{
 		// Iterate through the paths starting with the last directory given. That
 		// is, things in folders near the start of the path have the ability to
 		// override things in folders later in the path.
-		vector<string> dataFiles = Files::RecursiveList(source + "data/");
-		for(const string &path : dataFiles)
-			LoadFile(path, debugMode);
+		for(const string &path : Files::RecursiveList(source + "data/"))
+			if(path.length() >= 4 && !path.compare(path.length() - 4, 4, ".txt"))
+				dataFiles.push_back(path);
+	}
+	// Reading and parsing each file does not depend on any of the others, so
+	// that can be done in parallel. But, the objects they define must be loaded
+	// in order, because later files may modify things defined in earlier ones.
+	// If requested, any files that have not changed since the last time the
+	// game was started are loaded from the data cache instead of being parsed.
+	unique_ptr<DataCache> cache;
+	if(useDataCache)
+		cache.reset(new DataCache(Files::Config() + "data cache", dataFiles));
+	vector<unique_ptr<DataFile>> parsed(dataFiles.size());
+	// An error reading a file must not escape a worker thread, so it is stored
+	// and then thrown again from this thread once all the files are done.
+	vector<exception_ptr> errors(dataFiles.size());
+	WorkerPool::Run(dataFiles.size(), 1, [&dataFiles, &parsed, &cache, &errors](int start, int end)
+	{
+		for(int i = start; i < end; ++i)
+		{
+			try {
+				parsed[i].reset(new DataFile);
+				if(cache)
+					cache->Load(i, *parsed[i]);
+				else
+					parsed[i]->Load(dataFiles[i]);
+			}
+			catch(...)
+			{
+				errors[i] = current_exception();
+			}
+		}
+	});
+	for(const exception_ptr &error : errors)
+		if(error)
+			rethrow_exception(error);
+	if(cache && cache->IsStale())
+		cache->Save(parsed);
+	cache.reset();
+	for(size_t i = 0; i < dataFiles.size(); ++i)
+	{
+		LoadFile(dataFiles[i], *parsed[i], debugMode);
+		// Each file's nodes are no longer needed once it has been loaded.
+		parsed[i].reset();
 	}
 	
 	// Now that all the stars are loaded, update the neighbor lists.
 	UpdateNeighbors();
+	// Weapons can only work out their range once their submunitions are loaded.
+	for(auto &it : outfits)
+		it.second.FinishLoadingWeapon();
 	// And, update the ships with the outfits we've now finished loading.
 	for(auto &it : ships)
 		it.second.FinishLoading(true);
@@ -328,6 +383,8 @@ void GameData::Revert()
 	
 	politics.Reset();
 	purchases.clear();
+	DistanceMap::ClearCache();
+	jumpTable.Update(systems);
 }
 
 
@@ -460,12 +517,23 @@ void GameData::AddPurchase(const System &system, const string &commodity, int to
 // Apply the given change to the universe.
 void GameData::Change(const DataNode &node)
 {
+	// Changing a system, its links, or a planet (which may be a wormhole) may
+	// change the routes between systems. So may changing a fleet, because routes
+	// avoid dangerous systems. (Changing a government updates the politics,
+	// which clears the cache if that changes who the player's enemies are.)
+	const string &key = node.Token(0);
+	if(key == "system" || key == "link" || key == "unlink" || key == "planet" || key == "fleet")
+		DistanceMap::ClearCache();
+	
 	if(node.Token(0) == "fleet" && node.Size() >= 2)
 		fleets.Get(node.Token(1))->Load(node);
 	else if(node.Token(0) == "galaxy" && node.Size() >= 2)
 		galaxies.Get(node.Token(1))->Load(node);
 	else if(node.Token(0) == "government" && node.Size() >= 2)
+	{
 		governments.Get(node.Token(1))->Load(node);
+		politics.UpdateAttitudes();
+	}
 	else if(node.Token(0) == "outfitter" && node.Size() >= 2)
 		outfitSales.Get(node.Token(1))->Load(node, outfits);
 	else if(node.Token(0) == "planet" && node.Size() >= 2)
@@ -490,6 +558,17 @@ void GameData::UpdateNeighbors()
 {
 	for(auto &it : systems)
 		it.second.UpdateNeighbors(systems);
+	DistanceMap::ClearCache();
+	jumpTable.Update(systems);
+}
+
+
+
+// Get the number of hyperspace jumps from one system to another, or -1 if
+// there is no route between them.
+int GameData::Jumps(const System *from, const System *to)
+{
+	return jumpTable.Jumps(from, to);
 }
 
 
@@ -764,13 +843,8 @@ void GameData::LoadSources()
 
 
 
-void GameData::LoadFile(const string &path, bool debugMode)
+void GameData::LoadFile(const string &path, const DataFile &data, bool debugMode)
 {
-	// This is an ordinary file. Check to see if it is an image.
-	if(path.length() < 4 || path.compare(path.length() - 4, 4, ".txt"))
-		return;
-	
-	DataFile data(path);
 	if(debugMode)
 		Files::LogError("Parsing: " + path);
 	
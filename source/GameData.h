@@ -22,6 +22,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 class Color;
 class Conversation;
+class DataFile;
 class DataNode;
 class DataWriter;
 class Date;
@@ -80,6 +81,9 @@ public:
 	// Update the neighbor lists of all the systems. This must be done any time
 	// that a change creates or moves a system.
 	static void UpdateNeighbors();
+	// Get the number of hyperspace jumps from one system to another, or -1 if
+	// there is no route between them. This ignores jump drives and wormholes.
+	static int Jumps(const System *from, const System *to);
 	
 	static const Set<Color> &Colors();
 	static const Set<Conversation> &Conversations();
@@ -124,7 +128,7 @@ public:
 	
 private:
 	static void LoadSources();
-	static void LoadFile(const std::string &path, bool debugMode);
+	static void LoadFile(const std::string &path, const DataFile &data, bool debugMode);
 	static void LoadImages(std::map<std::string, std::string> &images);
 	static void LoadImage(const std::string &path, std::map<std::string, std::string> &images, size_t start);
 	static std::string Name(const std::string &path);
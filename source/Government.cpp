@@ -132,6 +132,14 @@ const string &Government::GetName() const
 
 
 
+// Get the number that identifies this government in lookup tables.
+unsigned Government::Index() const
+{
+	return id;
+}
+
+
+
 // Get the color swizzle to use for ships of this government.
 int Government::GetSwizzle() const
 {
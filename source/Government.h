@@ -44,6 +44,9 @@ public:
 	
 	// Get the name of this government.
 	const std::string &GetName() const;
+	// Get the number that identifies this government in lookup tables. Every
+	// government has a different number, starting from zero.
+	unsigned Index() const;
 	// Get the color swizzle to use for ships of this government.
 	int GetSwizzle() const;
 	// Get the color to use for displaying this government on the map.
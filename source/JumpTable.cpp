@@ -0,0 +1,100 @@
+/* JumpTable.cpp
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "JumpTable.h"
+
+#include "DistanceMap.h"
+#include "System.h"
+#include "WorkerPool.h"
+
+using namespace std;
+
+namespace {
+	// Values in the table that are not an actual number of jumps. Any route
+	// that is too long to fit in the table is looked up the slow way instead.
+	const uint8_t NO_ROUTE = 255;
+	const uint8_t TOO_FAR = 254;
+	
+	// Number of starting systems handed to a worker thread at a time.
+	const int BLOCK_SIZE = 16;
+}
+
+
+
+// Calculate the distances between all the given systems.
+void JumpTable::Update(const Set<System> &systems)
+{
+	index.clear();
+	count = 0;
+	for(const auto &it : systems)
+		index[&it.second] = count++;
+	
+	// Convert the links into lists of indices, with each system's links
+	// starting at the offset given for it.
+	vector<int> offsets;
+	vector<int> links;
+	offsets.reserve(count + 1);
+	for(const auto &it : systems)
+	{
+		offsets.push_back(links.size());
+		for(const System *link : it.second.Links())
+		{
+			auto lit = index.find(link);
+			if(lit != index.end())
+				links.push_back(lit->second);
+		}
+	}
+	offsets.push_back(links.size());
+	
+	// Do a breadth-first search from each system to fill in its row.
+	jumps.assign(static_cast<size_t>(count) * count, NO_ROUTE);
+	WorkerPool::Run(count, BLOCK_SIZE, [this, &offsets, &links](int start, int end)
+	{
+		vector<int> queue;
+		for(int source = start; source < end; ++source)
+		{
+			uint8_t *row = &jumps[static_cast<size_t>(source) * count];
+			row[source] = 0;
+			queue.assign(1, source);
+			for(size_t i = 0; i < queue.size(); ++i)
+			{
+				int from = queue[i];
+				uint8_t next = (row[from] < TOO_FAR) ? row[from] + 1 : TOO_FAR;
+				for(int j = offsets[from]; j < offsets[from + 1]; ++j)
+					if(row[links[j]] == NO_ROUTE)
+					{
+						row[links[j]] = next;
+						queue.push_back(links[j]);
+					}
+			}
+		}
+	});
+}
+
+
+
+// Get the number of jumps from one system to another, or -1 if there is no
+// route between them.
+int JumpTable::Jumps(const System *from, const System *to) const
+{
+	auto fit = index.find(from);
+	auto tit = index.find(to);
+	if(fit == index.end() || tit == index.end())
+		return -1;
+	
+	uint8_t value = jumps[static_cast<size_t>(fit->second) * count + tit->second];
+	if(value == NO_ROUTE)
+		return -1;
+	if(value == TOO_FAR)
+		return DistanceMap::Cached(from)->Days(to);
+	return value;
+}
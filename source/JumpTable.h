@@ -0,0 +1,52 @@
+/* JumpTable.h
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef JUMP_TABLE_H_
+#define JUMP_TABLE_H_
+
+#include "Set.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class System;
+
+
+
+// A table of how many hyperspace jumps it takes to get from every system to
+// every other system, using only the hyperspace links (not jump drives or
+// wormholes). This is what a DistanceMap with no ship or player calculates,
+// but finding the distance between two systems is just a table lookup. The
+// table must be updated whenever the links between systems change.
+class JumpTable {
+public:
+	// Calculate the distances between all the given systems.
+	void Update(const Set<System> &systems);
+	
+	// Get the number of jumps from one system to another, or -1 if there is
+	// no route between them.
+	int Jumps(const System *from, const System *to) const;
+	
+	
+private:
+	// Each system's row and column in the table.
+	std::unordered_map<const System *, int> index;
+	int count = 0;
+	// The distance from every system to every other system, one row for each
+	// starting system.
+	std::vector<uint8_t> jumps;
+};
+
+
+
+#endif
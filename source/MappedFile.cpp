@@ -0,0 +1,118 @@
+/* MappedFile.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "MappedFile.h"
+
+#include "Files.h"
+
+#if !defined _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+	// Mapping a file has a fixed cost that is only worth paying for files that
+	// are bigger than this. Anything smaller is just read.
+	const size_t MAP_THRESHOLD = 64 * 1024;
+}
+
+
+
+MappedFile::MappedFile(const string &path)
+{
+#if defined _WIN32
+	buffer = Files::Read(path);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if(file < 0)
+		return;
+	
+	struct stat buf;
+	size_t size = fstat(file, &buf) ? 0 : buf.st_size;
+	if(size >= MAP_THRESHOLD)
+	{
+		void *result = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		if(result != MAP_FAILED)
+		{
+			map = result;
+			data = static_cast<const char *>(map);
+			length = size;
+		}
+	}
+	if(!map && size)
+	{
+		// The size is known, so the whole file can be read at once.
+		buffer.resize(size);
+		size_t bytes = 0;
+		while(bytes < size)
+		{
+			ssize_t count = read(file, &buffer[bytes], size - bytes);
+			if(count <= 0)
+			{
+				close(file);
+				throw runtime_error("Error reading file!");
+			}
+			bytes += count;
+		}
+	}
+	close(file);
+#endif
+	if(!map)
+	{
+		data = buffer.data();
+		length = buffer.size();
+	}
+}
+
+
+
+MappedFile::~MappedFile()
+{
+#if !defined _WIN32
+	if(map)
+		munmap(map, length);
+#endif
+}
+
+
+
+const char *MappedFile::begin() const
+{
+	return data;
+}
+
+
+
+const char *MappedFile::end() const
+{
+	return data + length;
+}
+
+
+
+size_t MappedFile::size() const
+{
+	return length;
+}
+
+
+
+bool MappedFile::empty() const
+{
+	return !length;
+}
@@ -0,0 +1,52 @@
+/* MappedFile.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+
+
+// Read-only access to the entire contents of a file. Large files are mapped
+// into memory, so they can be used in place without copying them; small files
+// (or any file, on systems where mapping is not supported) are read into a
+// buffer with a single read. Either way, the data stays valid for as long as
+// this object exists.
+class MappedFile {
+public:
+	explicit MappedFile(const std::string &path);
+	MappedFile(const MappedFile &) = delete;
+	~MappedFile();
+	
+	MappedFile &operator=(const MappedFile &) = delete;
+	
+	// Get the file contents. If the file could not be read, it is empty.
+	const char *begin() const;
+	const char *end() const;
+	size_t size() const;
+	bool empty() const;
+	
+	
+private:
+	// If the file is mapped, this is the mapping. Otherwise, it is null and
+	// the contents are in the buffer instead.
+	void *map = nullptr;
+	std::string buffer;
+	const char *data = nullptr;
+	size_t length = 0;
+};
+
+
+
+#endif
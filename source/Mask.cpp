@@ -18,9 +18,17 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include <cmath>
 #include <limits>
 
+#ifdef __SSE3__
+#include <pmmintrin.h>
+#endif
+
 using namespace std;
 
 namespace {
+	// Number of edges in each chunk of the outline. This must be a multiple of
+	// the number of edges that the vector code below tests at once.
+	const int CHUNK_SIZE = 8;
+	
 	// Trace out a pixmap.
 	void Trace(ImageBuffer *image, vector<Point> *raw)
 	{
@@ -206,6 +214,105 @@ namespace {
 			radius = max(radius, p.LengthSquared());
 		return sqrt(radius);
 	}
+	
+	
+	// Find the closest point where the segment from sA to sA + vA enters the
+	// polygon through one of the CHUNK_SIZE edges given by these coordinates.
+	// An edge is only crossed if the segment goes from its outside to its
+	// inside (i.e. the cross product of the two is positive).
+	double IntersectEdges(const double *x0, const double *y0, const double *x1, const double *y1, Point sA, Point vA)
+	{
+#ifdef __SSE3__
+		// Test two edges at a time.
+		const __m128d ax = _mm_set1_pd(sA.X());
+		const __m128d ay = _mm_set1_pd(sA.Y());
+		const __m128d vx = _mm_set1_pd(vA.X());
+		const __m128d vy = _mm_set1_pd(vA.Y());
+		const __m128d zero = _mm_setzero_pd();
+		const __m128d one = _mm_set1_pd(1.);
+		__m128d closest = one;
+		for(int i = 0; i < CHUNK_SIZE; i += 2)
+		{
+			__m128d prevX = _mm_loadu_pd(x0 + i);
+			__m128d prevY = _mm_loadu_pd(y0 + i);
+			__m128d bx = _mm_sub_pd(_mm_loadu_pd(x1 + i), prevX);
+			__m128d by = _mm_sub_pd(_mm_loadu_pd(y1 + i), prevY);
+			__m128d sx = _mm_sub_pd(prevX, ax);
+			__m128d sy = _mm_sub_pd(prevY, ay);
+			
+			__m128d cross = _mm_sub_pd(_mm_mul_pd(bx, vy), _mm_mul_pd(by, vx));
+			__m128d uB = _mm_sub_pd(_mm_mul_pd(vx, sy), _mm_mul_pd(vy, sx));
+			__m128d uA = _mm_sub_pd(_mm_mul_pd(bx, sy), _mm_mul_pd(by, sx));
+			
+			__m128d hit = _mm_and_pd(_mm_cmpgt_pd(cross, zero), _mm_cmpge_pd(uB, zero));
+			hit = _mm_and_pd(hit, _mm_and_pd(_mm_cmplt_pd(uB, cross), _mm_cmpge_pd(uA, zero)));
+			// Edges that are not hit contribute a value of 1.
+			__m128d range = _mm_or_pd(_mm_and_pd(hit, _mm_div_pd(uA, cross)), _mm_andnot_pd(hit, one));
+			closest = _mm_min_pd(closest, range);
+		}
+		closest = _mm_min_pd(closest, _mm_shuffle_pd(closest, closest, 0x01));
+		return _mm_cvtsd_f64(closest);
+#else
+		double closest = 1.;
+		for(int i = 0; i < CHUNK_SIZE; ++i)
+		{
+			Point vB(x1[i] - x0[i], y1[i] - y0[i]);
+			double cross = vB.Cross(vA);
+			if(cross > 0.)
+			{
+				Point vS = Point(x0[i], y0[i]) - sA;
+				double uB = vA.Cross(vS);
+				double uA = vB.Cross(vS);
+				if((uB >= 0.) & (uB < cross) & (uA >= 0.))
+					closest = min(closest, uA / cross);
+			}
+		}
+		return closest;
+#endif
+	}
+	
+	
+	// Count how many of the CHUNK_SIZE edges given by these coordinates are
+	// crossed by a ray pointing straight down from the given point. Edges are
+	// closed at the start and open at the end, and vertical edges are ignored.
+	int CrossedEdges(const double *x0, const double *y0, const double *x1, const double *y1, Point point)
+	{
+		int intersections = 0;
+#ifdef __SSE3__
+		// Test two edges at a time.
+		const __m128d px = _mm_set1_pd(point.X());
+		const __m128d py = _mm_set1_pd(point.Y());
+		for(int i = 0; i < CHUNK_SIZE; i += 2)
+		{
+			__m128d prevX = _mm_loadu_pd(x0 + i);
+			__m128d prevY = _mm_loadu_pd(y0 + i);
+			__m128d nextX = _mm_loadu_pd(x1 + i);
+			__m128d nextY = _mm_loadu_pd(y1 + i);
+			
+			// The edge must span the point's x coordinate.
+			__m128d spans = _mm_xor_pd(_mm_cmple_pd(prevX, px), _mm_cmplt_pd(px, nextX));
+			spans = _mm_andnot_pd(spans, _mm_cmpneq_pd(prevX, nextX));
+			// Find where the edge is at that x coordinate. (For edges that do
+			// not span it, this may be garbage, but those are masked out.)
+			__m128d y = _mm_div_pd(_mm_mul_pd(_mm_sub_pd(nextY, prevY), _mm_sub_pd(px, prevX)),
+				_mm_sub_pd(nextX, prevX));
+			y = _mm_add_pd(prevY, y);
+			int bits = _mm_movemask_pd(_mm_and_pd(spans, _mm_cmpge_pd(y, py)));
+			intersections += (bits & 1) + (bits >> 1);
+		}
+#else
+		for(int i = 0; i < CHUNK_SIZE; ++i)
+			if(x0[i] != x1[i])
+				if((x0[i] <= point.X()) == (point.X() < x1[i]))
+				{
+					double y = y0[i] + (y1[i] - y0[i]) *
+						(point.X() - x0[i]) / (x1[i] - x0[i]);
+					intersections += (y >= point.Y());
+				}
+#endif
+		return intersections;
+	}
+
 }
 
 
@@ -230,6 +337,52 @@ void Mask::Create(ImageBuffer *image)
 	Simplify(raw, &outline);
 	
 	radius = Radius(outline);
+	
+	// Store the edges in the order that the outline goes in, starting with the
+	// edge that leads to the first point.
+	startX.clear();
+	startY.clear();
+	endX.clear();
+	endY.clear();
+	chunks.clear();
+	if(outline.empty())
+		return;
+	
+	Point prev = outline.back();
+	for(const Point &next : outline)
+	{
+		startX.push_back(prev.X());
+		startY.push_back(prev.Y());
+		endX.push_back(next.X());
+		endY.push_back(next.Y());
+		prev = next;
+	}
+	// An edge of zero length that starts and ends at the last point in the
+	// outline cannot be intersected, and does not change its range.
+	while(endX.size() % CHUNK_SIZE)
+	{
+		startX.push_back(prev.X());
+		startY.push_back(prev.Y());
+		endX.push_back(prev.X());
+		endY.push_back(prev.Y());
+	}
+	
+	// Find the bounding box of each chunk of edges. Every point in the outline
+	// is the end of exactly one edge.
+	for(unsigned i = 0; i < endX.size(); i += CHUNK_SIZE)
+	{
+		Chunk chunk;
+		chunk.minX = *min_element(endX.begin() + i, endX.begin() + i + CHUNK_SIZE);
+		chunk.maxX = *max_element(endX.begin() + i, endX.begin() + i + CHUNK_SIZE);
+		chunk.minY = *min_element(endY.begin() + i, endY.begin() + i + CHUNK_SIZE);
+		chunk.maxY = *max_element(endY.begin() + i, endY.begin() + i + CHUNK_SIZE);
+		// The first edge of a chunk starts at the last point of the one before.
+		chunk.minX = min(chunk.minX, startX[i]);
+		chunk.maxX = max(chunk.maxX, startX[i]);
+		chunk.minY = min(chunk.minY, startY[i]);
+		chunk.maxY = max(chunk.maxY, startY[i]);
+		chunks.push_back(chunk);
+	}
 }
 
 
@@ -298,9 +451,16 @@ bool Mask::WithinRange(Point point, Angle facing, double range) const
 	// For efficiency, compare to range^2 instead of range.
 	range *= range;
 	
-	for(const Point &p : outline)
-		if(p.DistanceSquared(point) < range)
-			return true;
+	for(unsigned c = 0; c < chunks.size(); ++c)
+	{
+		// Skip any chunk that is entirely out of range.
+		if(chunks[c].DistanceSquared(point) >= range)
+			continue;
+		
+		for(unsigned i = c * CHUNK_SIZE; i < (c + 1) * CHUNK_SIZE; ++i)
+			if(Point(endX[i], endY[i]).DistanceSquared(point) < range)
+				return true;
+	}
 	
 	return false;
 }
@@ -319,10 +479,19 @@ double Mask::Range(Point point, Angle facing) const
 	if(Contains(point))
 		return 0.;
 	
-	for(const Point &p : outline)
-		range = min(range, p.Distance(point));
+	// Find the closest point, skipping any chunk that cannot contain a point
+	// closer than the closest one so far.
+	range *= range;
+	for(unsigned c = 0; c < chunks.size(); ++c)
+	{
+		if(chunks[c].DistanceSquared(point) >= range)
+			continue;
+		
+		for(unsigned i = c * CHUNK_SIZE; i < (c + 1) * CHUNK_SIZE; ++i)
+			range = min(range, Point(endX[i], endY[i]).DistanceSquared(point));
+	}
 	
-	return range;
+	return sqrt(range);
 }
 
 
@@ -332,27 +501,21 @@ double Mask::Intersection(Point sA, Point vA) const
 	// Keep track of the closest intersection point found.
 	double closest = 1.;
 	
-	Point prev = outline.back();
-	for(const Point &next : outline)
+	// An edge can only be intersected if its chunk's bounding box overlaps the
+	// bounding box of the segment.
+	Point end = sA + vA;
+	double minX = min(sA.X(), end.X());
+	double minY = min(sA.Y(), end.Y());
+	double maxX = max(sA.X(), end.X());
+	double maxY = max(sA.Y(), end.Y());
+	for(unsigned c = 0; c < chunks.size(); ++c)
 	{
-		// Check if there is an intersection. (If not, the cross would be 0.) If
-		// there is, handle it only if it is a point where the segment is
-		// entering the polygon rather than exiting it (i.e. cross > 0).
-		Point vB = next - prev;
-		double cross = vB.Cross(vA);
-		if(cross > 0.)
-		{
-			Point vS = prev - sA;
-			double uB = vA.Cross(vS);
-			double uA = vB.Cross(vS);
-			// If the intersection occurs somewhere within this segment of the
-			// outline, find out how far along the query vector it occurs and
-			// remember it if it is the closest so far.
-			if((uB >= 0.) & (uB < cross) & (uA >= 0.))
-				closest = min(closest, uA / cross);
-		}
+		const Chunk &chunk = chunks[c];
+		if(chunk.maxX < minX || chunk.minX > maxX || chunk.maxY < minY || chunk.minY > maxY)
+			continue;
 		
-		prev = next;
+		unsigned i = c * CHUNK_SIZE;
+		closest = min(closest, IntersectEdges(&startX[i], &startY[i], &endX[i], &endY[i], sA, vA));
 	}
 	return closest;
 }
@@ -367,20 +530,30 @@ bool Mask::Contains(Point point) const
 	// open at the end to avoid double-counting.
 	
 	// For simplicity, use a ray pointing straight downwards. A segment then
-	// intersects only if its x coordinates span the point's coordinates.
+	// intersects only if its x coordinates span the point's coordinates. So,
+	// a chunk can be skipped if it is entirely to one side of the point, or
+	// entirely above it.
 	int intersections = 0;
-	Point prev = outline.back();
-	for(const Point &next : outline)
+	for(unsigned c = 0; c < chunks.size(); ++c)
 	{
-		if(prev.X() != next.X())
-			if((prev.X() <= point.X()) == (point.X() < next.X()))
-			{
-				double y = prev.Y() + (next.Y() - prev.Y()) *
-					(point.X() - prev.X()) / (next.X() - prev.X());
-				intersections += (y >= point.Y());
-			}
-		prev = next;
+		const Chunk &chunk = chunks[c];
+		if(point.X() < chunk.minX || point.X() > chunk.maxX || point.Y() > chunk.maxY)
+			continue;
+		
+		unsigned i = c * CHUNK_SIZE;
+		intersections += CrossedEdges(&startX[i], &startY[i], &endX[i], &endY[i], point);
 	}
 	// If the number of intersections is odd, the point is within the mask.
 	return (intersections & 1);
 }
+
+
+
+// Get the squared distance from the given point to this box, or zero if the
+// point is inside it.
+double Mask::Chunk::DistanceSquared(const Point &point) const
+{
+	double dx = max(0., max(minX - point.X(), point.X() - maxX));
+	double dy = max(0., max(minY - point.Y(), point.Y() - maxY));
+	return dx * dx + dy * dy;
+}
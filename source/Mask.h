@@ -61,8 +61,32 @@ private:
 	bool Contains(Point point) const;
 	
 	
+private:
+	// A bounding box around a fixed number of consecutive edges. Most of the
+	// edges of a large mask can be skipped just by checking these boxes.
+	class Chunk {
+	public:
+		// Get the squared distance from the given point to this box, or zero if
+		// the point is inside it.
+		double DistanceSquared(const Point &point) const;
+		
+		double minX;
+		double minY;
+		double maxX;
+		double maxY;
+	};
+	
+	
 private:
 	std::vector<Point> outline;
+	// Each edge of the outline, with its coordinates stored in separate arrays
+	// so that several edges can be tested at once. Edge i goes from outline[i -
+	// 1] to outline[i]. The last chunk is padded out with edges of zero length.
+	std::vector<double> startX;
+	std::vector<double> startY;
+	std::vector<double> endX;
+	std::vector<double> endY;
+	std::vector<Chunk> chunks;
 	double radius;
 };
 
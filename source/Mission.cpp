@@ -15,7 +15,6 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "DataNode.h"
 #include "DataWriter.h"
 #include "Dialog.h"
-#include "DistanceMap.h"
 #include "Format.h"
 #include "GameData.h"
 #include "Government.h"
@@ -956,19 +955,17 @@ Mission Mission::Instantiate(const PlayerInfo &player) const
 	while(!destinations.empty())
 	{
 		// Find the closest destination to this location.
-		DistanceMap distance(source);
 		auto it = destinations.begin();
 		auto bestIt = it;
 		for(++it; it != destinations.end(); ++it)
-			if(distance.Days(*it) < distance.Days(*bestIt))
+			if(GameData::Jumps(source, *it) < GameData::Jumps(source, *bestIt))
 				bestIt = it;
 		
+		jumps += GameData::Jumps(source, *bestIt);
 		source = *bestIt;
-		jumps += distance.Days(*bestIt);
 		destinations.erase(bestIt);
 	}
-	DistanceMap distance(source);
-	jumps += distance.Days(result.destination->GetSystem());
+	jumps += GameData::Jumps(source, result.destination->GetSystem());
 	int payload = result.cargoSize + 10 * result.passengers;
 	
 	// Set the deadline, if requested.
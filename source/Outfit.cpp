@@ -18,12 +18,89 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "GameData.h"
 #include "SpriteSet.h"
 
+#include <atomic>
 #include <cmath>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 using namespace std;
 
 namespace {
 	const double EPS = 0.0000000001;
+	
+	// The ID of each attribute name, and the name of each ID. Names may be
+	// added while they are being looked up on other threads, so the lookup
+	// table is never modified in a way that a reader could see half done: new
+	// names are only added (under the mutex) by filling in an empty slot, and
+	// when the table needs to grow, a bigger copy of it is made and then put in
+	// its place. Looking up a name never needs to take the mutex.
+	class Entry {
+	public:
+		Entry(const string &name, int id) : name(name), id(id) {}
+		
+		const string name;
+		const int id;
+	};
+	
+	class Table {
+	public:
+		explicit Table(size_t size) : size(size), slots(new atomic<const Entry *>[size])
+		{
+			for(size_t i = 0; i < size; ++i)
+				slots[i].store(nullptr, memory_order_relaxed);
+		}
+		
+		// Find the slot for the given name: either the one it is in, or the
+		// empty slot where it would go.
+		atomic<const Entry *> &Find(const string &name) const
+		{
+			size_t mask = size - 1;
+			for(size_t i = hash<string>()(name) & mask; ; i = (i + 1) & mask)
+			{
+				const Entry *entry = slots[i].load(memory_order_acquire);
+				if(!entry || entry->name == name)
+					return slots[i];
+			}
+		}
+		
+		// The number of slots, which is always a power of two.
+		const size_t size;
+		unique_ptr<atomic<const Entry *>[]> slots;
+	};
+	
+	class Registry {
+	public:
+		Registry()
+		{
+			tables.emplace_back(new Table(1024));
+			table.store(tables.back().get(), memory_order_relaxed);
+		}
+		
+		// The current lookup table.
+		atomic<const Table *> table;
+		// All the entries, in order of their IDs. Old tables are kept as well,
+		// because another thread might still be looking something up in one.
+		vector<unique_ptr<Entry>> entries;
+		vector<unique_ptr<Table>> tables;
+		mutex lock;
+	};
+	
+	// Other files may ask for attribute IDs during static initialization, so
+	// the registry must be created the first time it is used.
+	Registry &GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+	
+	// Get the ID of the given attribute, or -1 if it does not have one.
+	int FindAttribute(const string &name)
+	{
+		const Table *table = GetRegistry().table.load(memory_order_acquire);
+		const Entry *entry = table->Find(name).load(memory_order_acquire);
+		return entry ? entry->id : -1;
+	}
 }
 
 const vector<string> Outfit::CATEGORIES = {
@@ -40,6 +117,42 @@ const vector<string> Outfit::CATEGORIES = {
 
 
 
+// Get the ID of the attribute with the given name, assigning it one if it does
+// not have one yet. IDs never change once they are assigned.
+int Outfit::AttributeID(const string &name)
+{
+	int id = FindAttribute(name);
+	if(id >= 0)
+		return id;
+	
+	Registry &registry = GetRegistry();
+	lock_guard<mutex> lock(registry.lock);
+	// Another thread may have added this name since it was checked for.
+	const Table *table = registry.table.load(memory_order_relaxed);
+	const Entry *entry = table->Find(name).load(memory_order_relaxed);
+	if(entry)
+		return entry->id;
+	
+	id = registry.entries.size();
+	registry.entries.emplace_back(new Entry(name, id));
+	entry = registry.entries.back().get();
+	
+	// Keep the table no more than half full, so searches stay short.
+	if(2 * registry.entries.size() > table->size)
+	{
+		Table *bigger = new Table(2 * table->size);
+		registry.tables.emplace_back(bigger);
+		for(const unique_ptr<Entry> &it : registry.entries)
+			bigger->Find(it->name).store(it.get(), memory_order_relaxed);
+		registry.table.store(bigger, memory_order_release);
+	}
+	else
+		table->Find(name).store(entry, memory_order_release);
+	return id;
+}
+
+
+
 void Outfit::Load(const DataNode &node)
 {
 	if(node.Size() >= 2)
@@ -84,13 +197,15 @@ void Outfit::Load(const DataNode &node)
 				licenses.push_back(grand.Token(0));
 		}
 		else if(child.Size() >= 2)
-			attributes[child.Token(0)] = child.Value(1);
+			Value(AttributeID(child.Token(0))) = child.Value(1);
 		else
 			child.PrintTrace("Skipping unrecognized attribute:");
 	}
 	
 	// Legacy support for turrets that don't specify a turn rate:
-	if(IsWeapon() && attributes.count("turret mounts") && !TurretTurn() && !AntiMissile())
+	static const int TURRET_MOUNTS = AttributeID("turret mounts");
+	bool hasTurretMounts = Has(TURRET_MOUNTS);
+	if(IsWeapon() && hasTurretMounts && !TurretTurn() && !AntiMissile())
 		SetTurretTurn(4.);
 }
 
@@ -142,15 +257,22 @@ const Sprite *Outfit::Thumbnail() const
 
 double Outfit::Get(const string &attribute) const
 {
-	auto it = attributes.find(attribute);
-	return (it == attributes.end()) ? 0. : it->second;
+	int id = FindAttribute(attribute);
+	return (id < 0) ? 0. : Get(id);
 }
 
 
 
-const map<string, double> &Outfit::Attributes() const
+// Get all the attributes that have been given a value, by name.
+map<string, double> Outfit::Attributes() const
 {
-	return attributes;
+	map<string, double> result;
+	Registry &registry = GetRegistry();
+	lock_guard<mutex> lock(registry.lock);
+	for(unsigned i = 0; i < hasAttribute.size(); ++i)
+		if(hasAttribute[i])
+			result[registry.entries[i]->name] = attributes[i];
+	return result;
 }
 
 
@@ -160,12 +282,16 @@ const map<string, double> &Outfit::Attributes() const
 // not, return the maximum number that can be added.
 int Outfit::CanAdd(const Outfit &other, int count) const
 {
-	for(const auto &at : other.attributes)
+	for(unsigned i = 0; i < other.hasAttribute.size(); ++i)
 	{
-		double value = Get(at.first);
+		if(!other.hasAttribute[i])
+			continue;
+		
+		double value = Get(i);
+		double otherValue = other.attributes[i];
 		// Allow for rounding errors:
-		if(value + at.second * count < -EPS)
-			count = value / -at.second + EPS;
+		if(value + otherValue * count < -EPS)
+			count = value / -otherValue + EPS;
 	}
 	
 	return count;
@@ -178,11 +304,15 @@ int Outfit::CanAdd(const Outfit &other, int count) const
 void Outfit::Add(const Outfit &other, int count)
 {
 	cost += other.cost * count;
-	for(const auto &at : other.attributes)
+	for(unsigned i = 0; i < other.hasAttribute.size(); ++i)
 	{
-		attributes[at.first] += at.second * count;
-		if(fabs(attributes[at.first]) < EPS)
-			attributes[at.first] = 0.;
+		if(!other.hasAttribute[i])
+			continue;
+		
+		double &value = Value(i);
+		value += other.attributes[i] * count;
+		if(fabs(value) < EPS)
+			value = 0.;
 	}
 	
 	for(const auto &it : other.flareSprites)
@@ -208,9 +338,10 @@ void Outfit::Add(const Outfit &other, int count)
 // Modify this outfit's attributes.
 void Outfit::Add(const string &attribute, double value)
 {
-	attributes[attribute] += value;
-	if(fabs(attributes[attribute]) < EPS)
-		attributes[attribute] = 0.;
+	double &total = Value(AttributeID(attribute));
+	total += value;
+	if(fabs(total) < EPS)
+		total = 0.;
 }
 
 
@@ -218,7 +349,7 @@ void Outfit::Add(const string &attribute, double value)
 // Modify this outfit's attributes.
 void Outfit::Reset(const string &attribute, double value)
 {
-	attributes[attribute] = value;
+	Value(AttributeID(attribute)) = value;
 }
 
 
@@ -251,3 +382,18 @@ const Sprite *Outfit::FlotsamSprite() const
 {
 	return flotsamSprite;
 }
+
+
+
+// Get a reference to the value of the given attribute, marking it as having
+// been given a value.
+double &Outfit::Value(int attribute)
+{
+	if(static_cast<unsigned>(attribute) >= attributes.size())
+	{
+		attributes.resize(attribute + 1, 0.);
+		hasAttribute.resize(attribute + 1, false);
+	}
+	hasAttribute[attribute] = true;
+	return attributes[attribute];
+}
@@ -34,11 +34,19 @@ class Sprite;
 // set of attributes unique to them, and outfits can also specify additional
 // information like the sprite to use in the outfitter panel for selling them,
 // or the sprite or sound to be used for an engine flare.
+// Each attribute name is given a small integer ID the first time it is seen,
+// and the attribute values are stored in an array indexed by that ID. Code
+// that looks up the same attribute over and over should get its ID once, with
+// AttributeID(), instead of looking it up by name each time.
 class Outfit : public Weapon {
 public:
 	// These are all the possible category strings for outfits.
 	static const std::vector<std::string> CATEGORIES;
 	
+	// Get the ID of the attribute with the given name, assigning it one if it
+	// does not have one yet. IDs never change once they are assigned.
+	static int AttributeID(const std::string &name);
+	
 public:
 	// An "outfit" can be loaded from an "outfit" node or from a ship's
 	// "attributes" node.
@@ -54,8 +62,13 @@ public:
 	// Get the image to display in the outfitter when buying this item.
 	const Sprite *Thumbnail() const;
 	
+	double Get(int attribute) const;
 	double Get(const std::string &attribute) const;
-	const std::map<std::string, double> &Attributes() const;
+	// Check if the given attribute has been given a value, even if it is zero.
+	bool Has(int attribute) const;
+	// Get all the attributes that have been given a value, by name. This builds
+	// a new map, so it should not be used where speed matters.
+	std::map<std::string, double> Attributes() const;
 	
 	// Determine whether the given number of instances of the given outfit can
 	// be added to a ship with the attributes represented by this instance. If
@@ -77,6 +90,12 @@ public:
 	const Sprite *FlotsamSprite() const;
 	
 	
+private:
+	// Get a reference to the value of the given attribute, marking it as having
+	// been given a value.
+	double &Value(int attribute);
+	
+	
 private:
 	std::string name;
 	std::string pluralName;
@@ -87,7 +106,10 @@ private:
 	// Licenses needed to purchase this item.
 	std::vector<std::string> licenses;
 	
-	std::map<std::string, double> attributes;
+	// The value of each attribute, indexed by ID. An attribute that has never
+	// been given a value for this outfit may be past the end of the array.
+	std::vector<double> attributes;
+	std::vector<bool> hasAttribute;
 	
 	std::vector<std::pair<Body, int>> flareSprites;
 	std::map<const Sound *, int> flareSounds;
@@ -97,8 +119,16 @@ private:
 
 
 
-// This gets called a lot, so inline it for speed.
+// These get called a lot, so inline them for speed.
 inline int64_t Outfit::Cost() const { return cost; }
+inline double Outfit::Get(int attribute) const
+{
+	return (static_cast<unsigned>(attribute) < attributes.size()) ? attributes[attribute] : 0.;
+}
+inline bool Outfit::Has(int attribute) const
+{
+	return (static_cast<unsigned>(attribute) < hasAttribute.size()) && hasAttribute[attribute];
+}
 
 
 
@@ -268,8 +268,8 @@ void OutfitterPanel::Buy()
 		{
 			if(!HasMapped(mapSize))
 			{
-				DistanceMap distance(player.GetSystem(), mapSize);
-				for(const System *system : distance.Systems())
+				shared_ptr<const DistanceMap> distance = DistanceMap::Cached(player.GetSystem(), mapSize);
+				for(const System *system : distance->Systems())
 					if(!player.HasVisited(system))
 						player.Visit(system);
 				int64_t price = player.StockDepreciation().Value(selectedOutfit, day);
@@ -761,8 +761,8 @@ void OutfitterPanel::DrawOutfit(const Outfit &outfit, const Point &center, bool
 
 bool OutfitterPanel::HasMapped(int mapSize) const
 {
-	DistanceMap distance(player.GetSystem(), mapSize);
-	for(const System *system : distance.Systems())
+	shared_ptr<const DistanceMap> distance = DistanceMap::Cached(player.GetSystem(), mapSize);
+	for(const System *system : distance->Systems())
 		if(!player.HasVisited(system))
 			return false;
 	
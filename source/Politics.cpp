@@ -12,6 +12,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "Politics.h"
 
+#include "DistanceMap.h"
 #include "Format.h"
 #include "GameData.h"
 #include "Government.h"
@@ -43,11 +44,49 @@ void Politics::Reset()
 	// were already checked for when you first landed).
 	for(const auto &it : GameData::Governments())
 		fined.insert(&it.second);
+	
+	UpdateAttitudes();
+}
+
+
+
+// Update which governments are enemies of each other, after any of their
+// attitudes toward each other have changed.
+void Politics::UpdateAttitudes()
+{
+	governmentCount = 0;
+	for(const auto &it : GameData::Governments())
+		governmentCount = max(governmentCount, it.second.Index() + 1);
+	rowWords = (governmentCount + 63) / 64;
+	hostility.assign(governmentCount * rowWords, 0);
+	
+	// Any government that is not in this list (i.e. one that is created after
+	// this) is handled by the slower check instead.
+	for(const auto &first : GameData::Governments())
+		for(const auto &second : GameData::Governments())
+			SetEnemy(first.second.Index(), second.second.Index(),
+				CalculateIsEnemy(&first.second, &second.second));
+	
+	// Routes avoid systems with fleets that are hostile to the player, so any
+	// cached routes may now be out of date.
+	DistanceMap::ClearCache();
 }
 
 
 
 bool Politics::IsEnemy(const Government *first, const Government *second) const
+{
+	unsigned a = first->Index();
+	unsigned b = second->Index();
+	if(a < governmentCount && b < governmentCount)
+		return (hostility[a * rowWords + b / 64] >> (b % 64)) & 1;
+	
+	return CalculateIsEnemy(first, second);
+}
+
+
+
+bool Politics::CalculateIsEnemy(const Government *first, const Government *second) const
 {
 	if(first == second)
 		return false;
@@ -113,6 +152,7 @@ void Politics::Offend(const Government *gov, int eventType, int count)
 			reputationWith[other] -= penalty;
 		}
 	}
+	UpdatePlayer();
 }
 
 
@@ -123,6 +163,7 @@ void Politics::Bribe(const Government *gov)
 	bribed.insert(gov);
 	provoked.erase(gov);
 	fined.insert(gov);
+	UpdatePlayer();
 }
 
 
@@ -299,6 +340,7 @@ double Politics::Reputation(const Government *gov) const
 void Politics::AddReputation(const Government *gov, double value)
 {
 	reputationWith[gov] += value;
+	UpdatePlayer();
 }
 
 
@@ -306,6 +348,7 @@ void Politics::AddReputation(const Government *gov, double value)
 void Politics::SetReputation(const Government *gov, double value)
 {
 	reputationWith[gov] = value;
+	UpdatePlayer();
 }
 
 
@@ -317,4 +360,47 @@ void Politics::ResetDaily()
 	bribed.clear();
 	bribedPlanets.clear();
 	fined.clear();
+	UpdatePlayer();
+}
+
+
+
+// Update whether the player is an enemy of each government, after the player's
+// reputation, bribes, or provocations have changed.
+void Politics::UpdatePlayer()
+{
+	const Government *player = GameData::PlayerGovernment();
+	if(!player || player->Index() >= governmentCount)
+		return;
+	
+	bool changed = false;
+	for(const auto &it : GameData::Governments())
+	{
+		// Governments created after the matrix was built are not in it, and
+		// IsEnemy() checks them the slow way instead. There is no way to tell
+		// whether that answer has changed, so assume that it has.
+		if(it.second.Index() >= governmentCount)
+		{
+			changed = true;
+			continue;
+		}
+		
+		bool isEnemy = CalculateIsEnemy(player, &it.second);
+		changed |= SetEnemy(player->Index(), it.second.Index(), isEnemy);
+		changed |= SetEnemy(it.second.Index(), player->Index(), isEnemy);
+	}
+	// Routes avoid systems with fleets that are hostile to the player.
+	if(changed)
+		DistanceMap::ClearCache();
+}
+
+
+
+bool Politics::SetEnemy(unsigned first, unsigned second, bool isEnemy)
+{
+	uint64_t &word = hostility[first * rowWords + second / 64];
+	uint64_t bit = uint64_t(1) << (second % 64);
+	uint64_t old = word;
+	word = isEnemy ? (word | bit) : (word & ~bit);
+	return (word != old);
 }
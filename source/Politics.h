@@ -13,9 +13,11 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef POLITICS_H_
 #define POLITICS_H_
 
+#include <cstdint>
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 class Government;
 class Planet;
@@ -32,6 +34,9 @@ class Politics {
 public:
 	// Reset to the initial political state defined in the game data.
 	void Reset();
+	// Update which governments are enemies of each other, after any of their
+	// attitudes toward each other have changed.
+	void UpdateAttitudes();
 	
 	bool IsEnemy(const Government *first, const Government *second) const;
 	
@@ -66,6 +71,17 @@ public:
 	void ResetDaily();
 	
 	
+private:
+	// Check whether two governments are enemies, without using the matrix.
+	bool CalculateIsEnemy(const Government *first, const Government *second) const;
+	// Update whether the player is an enemy of each government, after the
+	// player's reputation, bribes, or provocations have changed.
+	void UpdatePlayer();
+	// Set whether the first government is an enemy of the second, and return
+	// true if that is a change.
+	bool SetEnemy(unsigned first, unsigned second, bool isEnemy);
+	
+	
 private:
 	// attitude[target][other] stores how much an action toward the given target
 	// government will affect your reputation with the given other government.
@@ -78,6 +94,13 @@ private:
 	std::map<const Planet *, bool> bribedPlanets;
 	std::set<const Planet *> dominatedPlanets;
 	std::set<const Government *> fined;
+	
+	// The result of IsEnemy() for every pair of governments, stored as a
+	// matrix of bits, with one row for each government's index. Each row is
+	// padded out to a whole number of words.
+	std::vector<uint64_t> hostility;
+	unsigned governmentCount = 0;
+	unsigned rowWords = 0;
 };
 
 
@@ -26,6 +26,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 using namespace std;
 
 namespace {
+	const int RADAR_JAMMING = Outfit::AttributeID("radar jamming");
+	
 	// Given the probability of losing a lock in five tries, check randomly
 	// whether it should be lost on this try.
 	inline bool Check(double probability, double base)
@@ -100,7 +102,7 @@ Projectile::Projectile(Point position, const Outfit *weapon)
 
 
 // This returns false if it is time to delete this projectile.
-bool Projectile::Move(list<Effect> &effects)
+bool Projectile::Move(vector<Effect> &effects)
 {
 	if(--lifetime <= 0)
 	{
@@ -225,7 +227,7 @@ bool Projectile::Move(list<Effect> &effects)
 
 // This is called when a projectile "dies," either of natural causes or
 // because it hit its target.
-void Projectile::MakeSubmunitions(list<Projectile> &projectiles) const
+void Projectile::MakeSubmunitions(vector<Projectile> &projectiles) const
 {
 	// Only make submunitions if you did *not* hit a target.
 	if(lifetime <= -100)
@@ -240,7 +242,7 @@ void Projectile::MakeSubmunitions(list<Projectile> &projectiles) const
 
 // This projectile hit something. Create the explosion, if any. This also
 // marks the projectile as needing deletion.
-void Projectile::Explode(list<Effect> &effects, double intersection, Point hitVelocity)
+void Projectile::Explode(vector<Effect> &effects, double intersection, Point hitVelocity)
 {
 	for(const auto &it : weapon->HitEffects())
 		for(int i = 0; i < it.second; ++i)
@@ -324,7 +326,7 @@ void Projectile::CheckLock(const Ship &target)
 	// Jamming of 1 is enough to increase your chance of dodging to 50%.
 	if(weapon->RadarTracking())
 	{
-		double probability = weapon->RadarTracking() / (1. + target.Attributes().Get("radar jamming"));
+		double probability = weapon->RadarTracking() / (1. + target.Attributes().Get(RADAR_JAMMING));
 		hasLock |= Check(probability, base);
 	}
 }
@@ -17,8 +17,8 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Body.h"
 #include "Point.h"
 
-#include <list>
 #include <memory>
+#include <vector>
 
 class Effect;
 class Government;
@@ -50,13 +50,13 @@ public:
 	*/
 	
 	// This returns false if it is time to delete this projectile.
-	bool Move(std::list<Effect> &effects);
+	bool Move(std::vector<Effect> &effects);
 	// This is called when a projectile "dies," either of natural causes or
 	// because it hit its target.
-	void MakeSubmunitions(std::list<Projectile> &projectiles) const;
+	void MakeSubmunitions(std::vector<Projectile> &projectiles) const;
 	// This projectile hit something. Create the explosion, if any. This also
 	// marks the projectile as needing deletion.
-	void Explode(std::list<Effect> &effects, double intersection, Point hitVelocity = Point());
+	void Explode(std::vector<Effect> &effects, double intersection, Point hitVelocity = Point());
 	// This projectile was killed, e.g. by an anti-missile system.
 	void Kill();
 	
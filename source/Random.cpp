@@ -14,24 +14,15 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include <random>
 
-#ifndef __linux__
-#include <mutex>
-#endif
-
 using namespace std;
 
-// Right now thread_local storage is only supported under Linux.
+// Each thread has its own generator, so that threads do not need to take
+// turns drawing numbers, and so that seeding one thread's generator (as the
+// worker pool does for each block of work) does not affect any other thread.
 namespace {
-#ifndef __linux__
-	mutex workaroundMutex;
-	mt19937_64 gen;
-	uniform_int_distribution<uint32_t> uniform;
-	uniform_real_distribution<double> real;
-#else
 	thread_local mt19937_64 gen;
 	thread_local uniform_int_distribution<uint32_t> uniform;
 	thread_local uniform_real_distribution<double> real;
-#endif
 }
 
 
@@ -40,9 +31,6 @@ namespace {
 // numbers it produced previously).
 void Random::Seed(uint64_t seed)
 {
-#ifndef __linux__
-	lock_guard<mutex> lock(workaroundMutex);
-#endif
 	gen.seed(seed);
 }
 
@@ -50,9 +38,6 @@ void Random::Seed(uint64_t seed)
 
 uint32_t Random::Int()
 {
-#ifndef __linux__
-	lock_guard<mutex> lock(workaroundMutex);
-#endif
 	return uniform(gen);
 }
 
@@ -60,9 +45,6 @@ uint32_t Random::Int()
 
 uint32_t Random::Int(uint32_t modulus)
 {
-#ifndef __linux__
-	lock_guard<mutex> lock(workaroundMutex);
-#endif
 	return uniform(gen) % modulus;
 }
 
@@ -70,9 +52,6 @@ uint32_t Random::Int(uint32_t modulus)
 
 double Random::Real()
 {
-#ifndef __linux__
-	lock_guard<mutex> lock(workaroundMutex);
-#endif
 	return real(gen);
 }
 
@@ -83,9 +62,6 @@ double Random::Real()
 uint32_t Random::Polya(uint32_t k, double p)
 {
 	negative_binomial_distribution<uint32_t> polya(k, p);
-#ifndef __linux__
-	lock_guard<mutex> lock(workaroundMutex);
-#endif
 	return polya(gen);
 }
 
@@ -95,9 +71,6 @@ uint32_t Random::Polya(uint32_t k, double p)
 uint32_t Random::Binomial(uint32_t t, double p)
 {
 	binomial_distribution<uint32_t> binomial(t, p);
-#ifndef __linux__
-	lock_guard<mutex> lock(workaroundMutex);
-#endif
 	return binomial(gen);
 }
 
@@ -107,8 +80,5 @@ uint32_t Random::Binomial(uint32_t t, double p)
 double Random::Normal()
 {
 	normal_distribution<double> normal;
-#ifndef __linux__
-	lock_guard<mutex> lock(workaroundMutex);
-#endif
 	return normal(gen);
 }
@@ -0,0 +1,318 @@
+/* Recording.cpp
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "Recording.h"
+
+#include "DataFile.h"
+#include "DataNode.h"
+#include "DataWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+namespace {
+	// Floating point values are written in hexadecimal so that they are read
+	// back in exactly, bit for bit.
+	string Exact(double value)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%a", value);
+		return buffer;
+	}
+	
+	double ReadExact(const DataNode &node, int index)
+	{
+		return (node.Size() > index) ? strtod(node.Token(index).c_str(), nullptr) : 0.;
+	}
+	
+	uint64_t Integer(const DataNode &node, int index)
+	{
+		return (node.Size() > index) ? strtoull(node.Token(index).c_str(), nullptr, 10) : 0;
+	}
+	
+	bool Flag(const DataNode &node, int index)
+	{
+		return (node.Size() > index && node.Value(index));
+	}
+}
+
+
+
+// Begin a new recording.
+void Recording::Start(const string &pilot, uint64_t seed, int step)
+{
+	this->pilot = pilot;
+	this->seed = seed;
+	this->step = step;
+	inputs.clear();
+}
+
+
+
+bool Recording::IsEmpty() const
+{
+	return inputs.empty();
+}
+
+
+
+// Load a recording from the given file.
+bool Recording::Load(const string &path)
+{
+	Start("", 0, 0);
+	
+	bool found = false;
+	DataFile file(path);
+	for(const DataNode &node : file)
+	{
+		if(node.Token(0) != "recording")
+		{
+			node.PrintTrace("Skipping unrecognized root object:");
+			continue;
+		}
+		found = true;
+		for(const DataNode &child : node)
+		{
+			const string &key = child.Token(0);
+			if(key == "pilot" && child.Size() >= 2)
+				pilot = child.Token(1);
+			else if(key == "seed")
+				seed = Integer(child, 1);
+			else if(key == "step" && child.Size() >= 2)
+				step = child.Value(1);
+			else if(key == "input")
+			{
+				for(const DataNode &grand : child)
+				{
+					const string &type = grand.Token(0);
+					inputs.emplace_back();
+					Input &input = inputs.back();
+					if(type == "step" && grand.Size() >= 6)
+					{
+						input.count = max(1, static_cast<int>(grand.Value(1)));
+						input.isActive = Flag(grand, 2);
+						input.keys.SetState(Integer(grand, 3));
+						input.shift = Flag(grand, 4);
+						input.zoom = ReadExact(grand, 5);
+						input.go = (grand.Size() >= 7 && grand.Token(6) == "go");
+					}
+					else if(type == "go")
+						input.type = Input::GO;
+					else if(type == "click" && grand.Size() >= 6)
+					{
+						input.type = Input::CLICK;
+						input.from = Point(ReadExact(grand, 1), ReadExact(grand, 2));
+						input.to = Point(ReadExact(grand, 3), ReadExact(grand, 4));
+						input.shift = Flag(grand, 5);
+					}
+					else if(type == "rclick" && grand.Size() >= 3)
+					{
+						input.type = Input::RCLICK;
+						input.from = Point(ReadExact(grand, 1), ReadExact(grand, 2));
+					}
+					else if(type == "group" && grand.Size() >= 4)
+					{
+						input.type = Input::GROUP;
+						input.group = grand.Value(1);
+						input.shift = Flag(grand, 2);
+						input.control = Flag(grand, 3);
+					}
+					else
+					{
+						grand.PrintTrace("Skipping unrecognized input:");
+						inputs.pop_back();
+					}
+				}
+			}
+			else
+				child.PrintTrace("Skipping unrecognized attribute:");
+		}
+	}
+	return found;
+}
+
+
+
+// Save this recording to the given file.
+void Recording::Save(const string &path) const
+{
+	DataWriter out(path);
+	
+	out.Write("recording");
+	out.BeginChild();
+	{
+		if(!pilot.empty())
+			out.Write("pilot", pilot);
+		out.Write("seed", to_string(seed));
+		out.Write("step", step);
+		out.Write("input");
+		out.BeginChild();
+		for(const Input &input : inputs)
+		{
+			if(input.type == Input::STEP)
+			{
+				out.WriteToken("step");
+				out.WriteToken(input.count);
+				out.WriteToken(input.isActive);
+				out.WriteToken(to_string(input.keys.State()));
+				out.WriteToken(input.shift);
+				out.WriteToken(Exact(input.zoom));
+				if(input.go)
+					out.WriteToken("go");
+				out.Write();
+			}
+			else if(input.type == Input::GO)
+				out.Write("go");
+			else if(input.type == Input::CLICK)
+				out.Write("click", Exact(input.from.X()), Exact(input.from.Y()),
+					Exact(input.to.X()), Exact(input.to.Y()), input.shift);
+			else if(input.type == Input::RCLICK)
+				out.Write("rclick", Exact(input.from.X()), Exact(input.from.Y()));
+			else if(input.type == Input::GROUP)
+				out.Write("group", input.group, input.shift, input.control);
+		}
+		out.EndChild();
+	}
+	out.EndChild();
+}
+
+
+
+const string &Recording::Pilot() const
+{
+	return pilot;
+}
+
+
+
+uint64_t Recording::Seed() const
+{
+	return seed;
+}
+
+
+
+int Recording::StartStep() const
+{
+	return step;
+}
+
+
+
+const vector<Recording::Input> &Recording::Inputs() const
+{
+	return inputs;
+}
+
+
+
+// Record one call to Engine::Step().
+void Recording::Step(bool isActive, const Command &keys, bool shift, double zoom)
+{
+	// The previous step is not complete until it is known whether Go() was
+	// called after it, so try to merge it now.
+	Merge();
+	
+	inputs.emplace_back();
+	Input &input = inputs.back();
+	input.isActive = isActive;
+	input.keys = keys;
+	input.shift = shift;
+	input.zoom = zoom;
+}
+
+
+
+// Record a call to Engine::Go(). This usually just marks the most recent step
+// as being followed by Go().
+void Recording::Go()
+{
+	if(!inputs.empty() && inputs.back().type == Input::STEP && !inputs.back().go)
+	{
+		// If this step was already merged with the ones before it, split it
+		// off from them again.
+		if(inputs.back().count > 1)
+		{
+			Input last = inputs.back();
+			--inputs.back().count;
+			last.count = 1;
+			inputs.push_back(last);
+		}
+		inputs.back().go = true;
+		Merge();
+	}
+	else
+	{
+		inputs.emplace_back();
+		inputs.back().type = Input::GO;
+	}
+}
+
+
+
+void Recording::Click(const Point &from, const Point &to, bool hasShift)
+{
+	Merge();
+	inputs.emplace_back();
+	Input &input = inputs.back();
+	input.type = Input::CLICK;
+	input.from = from;
+	input.to = to;
+	input.shift = hasShift;
+}
+
+
+
+void Recording::RClick(const Point &point)
+{
+	Merge();
+	inputs.emplace_back();
+	Input &input = inputs.back();
+	input.type = Input::RCLICK;
+	input.from = point;
+}
+
+
+
+void Recording::SelectGroup(int group, bool hasShift, bool hasControl)
+{
+	Merge();
+	inputs.emplace_back();
+	Input &input = inputs.back();
+	input.type = Input::GROUP;
+	input.group = group;
+	input.shift = hasShift;
+	input.control = hasControl;
+}
+
+
+
+// Combine the last input with the one before it, if they are identical steps.
+void Recording::Merge()
+{
+	if(inputs.size() < 2)
+		return;
+	
+	const Input &last = inputs.back();
+	Input &previous = inputs[inputs.size() - 2];
+	if(last.type != Input::STEP || previous.type != Input::STEP)
+		return;
+	if(last.isActive != previous.isActive || last.go != previous.go || last.shift != previous.shift
+			|| last.keys.State() != previous.keys.State() || last.zoom != previous.zoom)
+		return;
+	
+	previous.count += last.count;
+	inputs.pop_back();
+}
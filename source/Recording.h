@@ -0,0 +1,89 @@
+/* Recording.h
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef RECORDING_H_
+#define RECORDING_H_
+
+#include "Command.h"
+#include "Point.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+
+// A recording of everything the game engine needs in order to repeat a flight
+// exactly: the saved game it started from, the random seed, and every call that
+// passed player input to the engine (keys held down, clicks, and group
+// selections), in the order they happened. Runs of identical steps are stored
+// as a single entry, so a recording stays small even for a long flight.
+class Recording {
+public:
+	// One call to the engine. A STEP may be repeated several times in a row,
+	// and may be followed by a call to Go().
+	class Input {
+	public:
+		enum {STEP, GO, CLICK, RCLICK, GROUP};
+		
+		int type = STEP;
+		int count = 1;
+		bool isActive = false;
+		bool go = false;
+		Command keys;
+		bool shift = false;
+		bool control = false;
+		double zoom = 1.;
+		Point from;
+		Point to;
+		int group = 0;
+	};
+	
+	
+public:
+	// Begin a new recording. The pilot is the path to a saved game that the
+	// flight started from, or empty if it did not start from a saved game.
+	void Start(const std::string &pilot, uint64_t seed, int step);
+	bool IsEmpty() const;
+	
+	// Load or save a recording.
+	bool Load(const std::string &path);
+	void Save(const std::string &path) const;
+	
+	const std::string &Pilot() const;
+	uint64_t Seed() const;
+	int StartStep() const;
+	const std::vector<Input> &Inputs() const;
+	
+	// Record the input that the engine received.
+	void Step(bool isActive, const Command &keys, bool shift, double zoom);
+	void Go();
+	void Click(const Point &from, const Point &to, bool hasShift);
+	void RClick(const Point &point);
+	void SelectGroup(int group, bool hasShift, bool hasControl);
+	
+	
+private:
+	// Combine the last input with the one before it, if they are identical.
+	void Merge();
+	
+	
+private:
+	std::string pilot;
+	uint64_t seed = 0;
+	int step = 0;
+	std::vector<Input> inputs;
+};
+
+
+
+#endif
@@ -13,26 +13,40 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef SET_H_
 #define SET_H_
 
+#include <functional>
 #include <map>
 #include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 
 
 
 // Template representing a set of named objects of a given type, where you can
 // query it for a pointer to any object and it will return one, whether or not that
-// object has been loaded yet. (This allows cyclic pointers.)
+// object has been loaded yet. (This allows cyclic pointers.) The objects are
+// stored in order of their names, but looking one up by name is done through a
+// hash table, since that happens far more often than iterating over them.
 template<class Type>
 class Set {
 public:
+	Set() = default;
+	// Copying a set must rebuild the index, because the index points to the
+	// names and objects in the set it belongs to.
+	Set(const Set &other);
+	Set(Set &&other) = default;
+	Set &operator=(const Set &other);
+	Set &operator=(Set &&other) = default;
+	
 	// Allow non-const access to the owner of this set; it can hand off only
 	// const references to avoid anyone else modifying the objects.
-	Type *Get(const std::string &name) { return &data[name]; }
-	const Type *Get(const std::string &name) const { return &data[name]; }
+	Type *Get(const std::string &name) { return Insert(name); }
+	const Type *Get(const std::string &name) const { return Insert(name); }
 	// If an item already exists in this set, get it. Otherwise, return a null
 	// pointer rather than creating the item.
 	const Type *Find(const std::string &name) const;
 	
-	bool Has(const std::string &name) const { return data.count(name); }
+	bool Has(const std::string &name) const { return index.count(&name); }
 	
 	typename std::map<std::string, Type>::iterator begin() { return data.begin(); }
 	typename std::map<std::string, Type>::const_iterator begin() const { return data.begin(); }
@@ -46,16 +60,55 @@ public:
 	
 	
 private:
+	// Get the object with the given name, creating it if it does not exist.
+	Type *Insert(const std::string &name) const;
+	// Rebuild the index after the contents of this set have been copied.
+	void Reindex();
+	
+	
+private:
+	// The index is keyed by pointers to the names stored in the map, so each
+	// name is only stored once. Entries in a map never move, so these pointers
+	// stay valid until the entry is erased.
+	class NameHash {
+	public:
+		size_t operator()(const std::string *name) const { return std::hash<std::string>()(*name); }
+	};
+	class NameEqual {
+	public:
+		bool operator()(const std::string *a, const std::string *b) const { return *a == *b; }
+	};
+	
 	mutable std::map<std::string, Type> data;
+	mutable std::unordered_map<const std::string *, Type *, NameHash, NameEqual> index;
 };
 
 
 
+template <class Type>
+Set<Type>::Set(const Set &other)
+	: data(other.data)
+{
+	Reindex();
+}
+
+
+
+template <class Type>
+Set<Type> &Set<Type>::operator=(const Set &other)
+{
+	data = other.data;
+	Reindex();
+	return *this;
+}
+
+
+
 template <class Type>
 const Type *Set<Type>::Find(const std::string &name) const
 {
-	auto it = data.find(name);
-	return (it == data.end() ? nullptr : &it->second);
+	auto it = index.find(&name);
+	return (it == index.end() ? nullptr : it->second);
 }
 
 
@@ -69,7 +122,10 @@ void Set<Type>::Revert(const Set<Type> &other)
 	while(it != data.end())
 	{
 		if(oit == other.data.end() || it->first < oit->first)
+		{
+			index.erase(&it->first);
 			it = data.erase(it);
+		}
 		else if(it->first == oit->first)
 		{
 			// If this is an entry that is in the set we are reverting to, copy
@@ -86,4 +142,29 @@ void Set<Type>::Revert(const Set<Type> &other)
 
 
 
+template <class Type>
+Type *Set<Type>::Insert(const std::string &name) const
+{
+	auto it = index.find(&name);
+	if(it != index.end())
+		return it->second;
+	
+	auto dit = data.emplace(std::piecewise_construct, std::forward_as_tuple(name), std::forward_as_tuple()).first;
+	index.emplace(&dit->first, &dit->second);
+	return &dit->second;
+}
+
+
+
+template <class Type>
+void Set<Type>::Reindex()
+{
+	index.clear();
+	index.reserve(data.size());
+	for(auto &it : data)
+		index.emplace(&it.first, &it.second);
+}
+
+
+
 #endif
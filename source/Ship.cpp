@@ -34,6 +34,66 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 using namespace std;
 
 namespace {
+	// IDs of the attributes that ships look up, so that they do not need to be
+	// found by name every time.
+	const int ACTIVE_COOLING = Outfit::AttributeID("active cooling");
+	const int AFTERBURNER_ENERGY = Outfit::AttributeID("afterburner energy");
+	const int AFTERBURNER_FUEL = Outfit::AttributeID("afterburner fuel");
+	const int AFTERBURNER_HEAT = Outfit::AttributeID("afterburner heat");
+	const int AFTERBURNER_THRUST = Outfit::AttributeID("afterburner thrust");
+	const int AUTOMATON = Outfit::AttributeID("automaton");
+	const int BUNKS = Outfit::AttributeID("bunks");
+	const int CARGO_SCAN = Outfit::AttributeID("cargo scan");
+	const int CARGO_SCAN_POWER = Outfit::AttributeID("cargo scan power");
+	const int CARGO_SCAN_SPEED = Outfit::AttributeID("cargo scan speed");
+	const int CARGO_SPACE = Outfit::AttributeID("cargo space");
+	const int CLOAK = Outfit::AttributeID("cloak");
+	const int CLOAKING_ENERGY = Outfit::AttributeID("cloaking energy");
+	const int CLOAKING_FUEL = Outfit::AttributeID("cloaking fuel");
+	const int COOLING = Outfit::AttributeID("cooling");
+	const int COOLING_ENERGY = Outfit::AttributeID("cooling energy");
+	const int COOLING_INEFFICIENCY = Outfit::AttributeID("cooling inefficiency");
+	const int DISRUPTION_RESISTANCE = Outfit::AttributeID("disruption resistance");
+	const int DRAG = Outfit::AttributeID("drag");
+	const int ENERGY_CAPACITY = Outfit::AttributeID("energy capacity");
+	const int ENERGY_CONSUMPTION = Outfit::AttributeID("energy consumption");
+	const int ENERGY_GENERATION = Outfit::AttributeID("energy generation");
+	const int FUEL_CAPACITY = Outfit::AttributeID("fuel capacity");
+	const int HEAT_DISSIPATION = Outfit::AttributeID("heat dissipation");
+	const int HEAT_GENERATION = Outfit::AttributeID("heat generation");
+	const int HULL = Outfit::AttributeID("hull");
+	const int HULL_ENERGY = Outfit::AttributeID("hull energy");
+	const int HULL_HEAT = Outfit::AttributeID("hull heat");
+	const int HULL_REPAIR_RATE = Outfit::AttributeID("hull repair rate");
+	const int HYPERDRIVE = Outfit::AttributeID("hyperdrive");
+	const int ION_RESISTANCE = Outfit::AttributeID("ion resistance");
+	const int JUMP_DRIVE = Outfit::AttributeID("jump drive");
+	const int JUMP_FUEL = Outfit::AttributeID("jump fuel");
+	const int JUMP_SPEED = Outfit::AttributeID("jump speed");
+	const int MASS = Outfit::AttributeID("mass");
+	const int OUTFIT_SCAN = Outfit::AttributeID("outfit scan");
+	const int OUTFIT_SCAN_POWER = Outfit::AttributeID("outfit scan power");
+	const int OUTFIT_SCAN_SPEED = Outfit::AttributeID("outfit scan speed");
+	const int RAMSCOOP = Outfit::AttributeID("ramscoop");
+	const int REQUIRED_CREW = Outfit::AttributeID("required crew");
+	const int REVERSE_THRUST = Outfit::AttributeID("reverse thrust");
+	const int REVERSE_THRUSTING_ENERGY = Outfit::AttributeID("reverse thrusting energy");
+	const int REVERSE_THRUSTING_HEAT = Outfit::AttributeID("reverse thrusting heat");
+	const int SCRAM_DRIVE = Outfit::AttributeID("scram drive");
+	const int SELF_DESTRUCT = Outfit::AttributeID("self destruct");
+	const int SHIELD_ENERGY = Outfit::AttributeID("shield energy");
+	const int SHIELD_GENERATION = Outfit::AttributeID("shield generation");
+	const int SHIELD_HEAT = Outfit::AttributeID("shield heat");
+	const int SHIELDS = Outfit::AttributeID("shields");
+	const int SLOWING_RESISTANCE = Outfit::AttributeID("slowing resistance");
+	const int SOLAR_COLLECTION = Outfit::AttributeID("solar collection");
+	const int THRUST = Outfit::AttributeID("thrust");
+	const int THRUSTING_ENERGY = Outfit::AttributeID("thrusting energy");
+	const int THRUSTING_HEAT = Outfit::AttributeID("thrusting heat");
+	const int TURN = Outfit::AttributeID("turn");
+	const int TURNING_ENERGY = Outfit::AttributeID("turning energy");
+	const int TURNING_HEAT = Outfit::AttributeID("turning heat");
+	
 	const vector<string> BAY_TYPE = {"drone", "fighter"};
 	const vector<string> BAY_SIDE = {"inside", "over", "under"};
 	const vector<string> BAY_FACING = {"forward", "left", "right", "back"};
@@ -323,8 +383,10 @@ void Ship::FinishLoading(bool isNewInstance)
 	
 	// Mark any drone that has no "automaton" value as an automaton, to
 	// grandfather in the drones from before that attribute existed.
-	if(baseAttributes.Category() == "Drone" && !baseAttributes.Attributes().count("automaton"))
+	if(baseAttributes.Category() == "Drone" && !baseAttributes.Has(AUTOMATON))
 		baseAttributes.Add("automaton", 1.);
+	// A ship's explosion is a weapon defined in its attributes.
+	baseAttributes.FinishLoadingWeapon();
 	
 	baseAttributes.Reset("gun ports", armament.GunCount());
 	baseAttributes.Reset("turret mounts", armament.TurretCount());
@@ -350,7 +412,8 @@ void Ship::FinishLoading(bool isNewInstance)
 				armament.Add(it.first, count);
 		}
 	}
-	cargo.SetSize(attributes.Get("cargo space"));
+	cargo.SetSize(attributes.Get(CARGO_SPACE));
+	stats = CalculateStats();
 	equipped.clear();
 	armament.FinishLoading();
 	
@@ -545,7 +608,7 @@ void Ship::Place(Point position, Point velocity, Angle angle)
 	if(landingPlanet)
 	{
 		landingPlanet = nullptr;
-		zoom = parent.lock() ? (-.2 + -.8 * Random::Real()) : 0.;
+		zoom = parent ? (-.2 + -.8 * Random::Real()) : 0.;
 	}
 	else
 		zoom = 1.;
@@ -558,8 +621,8 @@ void Ship::Place(Point position, Point velocity, Angle angle)
 	jettisoned.clear();
 	hyperspaceCount = 0;
 	forget = 1;
-	targetShip.reset();
-	shipToAssist.reset();
+	targetShip = ShipHandle();
+	shipToAssist = ShipHandle();
 	if(government)
 		SetSwizzle(customSwizzle >= 0 ? customSwizzle : government->GetSwizzle());
 }
@@ -688,7 +751,7 @@ const Command &Ship::Commands() const
 // Move this ship. A ship may create effects as it moves, in particular if
 // it is in the process of blowing up. If this returns false, the ship
 // should be deleted.
-bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
+bool Ship::Move(vector<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 {
 	// Check if this ship has been in a different system from the player for so
 	// long that it should be "forgotten." Also eliminate ships that have no
@@ -698,7 +761,10 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 	if((!isSpecial && forget >= 1000) || !currentSystem)
 		return false;
 	isInSystem = false;
-	if(!fuel || !(attributes.Get("hyperdrive") || attributes.Get("jump drive")))
+#ifdef DEBUG
+	CheckStats();
+#endif
+	if(!fuel || !(attributes.Get(HYPERDRIVE) || attributes.Get(JUMP_DRIVE)))
 		hyperspaceSystem = nullptr;
 	
 	// Adjust the error in the pilot's targeting.
@@ -707,17 +773,17 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 	// Handle ionization effects, etc.
 	if(ionization)
 	{
-		ionization = max(0., .99 * ionization - attributes.Get("ion resistance"));
+		ionization = max(0., .99 * ionization - attributes.Get(ION_RESISTANCE));
 		CreateSparks(effects, "ion spark", ionization * .1);
 	}
 	if(disruption)
 	{
-		disruption = max(0., .99 * disruption - attributes.Get("disruption resistance"));
+		disruption = max(0., .99 * disruption - attributes.Get(DISRUPTION_RESISTANCE));
 		CreateSparks(effects, "disruption spark", disruption * .1);
 	}
 	if(slowness)
 	{
-		slowness = max(0., .99 * slowness - attributes.Get("slowing resistance"));
+		slowness = max(0., .99 * slowness - attributes.Get(SLOWING_RESISTANCE));
 		CreateSparks(effects, "slowing spark", slowness * .1);
 	}
 	double slowMultiplier = 1. / (1. + slowness * .05);
@@ -732,17 +798,17 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 	// maximum capacity for the rest of the turn, but must be clamped to the
 	// maximum here before they gain more. This is so that, for example, a ship
 	// with no batteries but a good generator can still move.
-	energy = min(energy, attributes.Get("energy capacity"));
+	energy = min(energy, attributes.Get(ENERGY_CAPACITY));
 	
-	heat -= .001 * heat * attributes.Get("heat dissipation");
+	heat -= .001 * heat * attributes.Get(HEAT_DISSIPATION);
 	if(heat > Mass() * 100.)
 		isOverheated = true;
 	else if(heat < Mass() * 90.)
 		isOverheated = false;
 	
-	double maxShields = attributes.Get("shields");
+	double maxShields = attributes.Get(SHIELDS);
 	shields = min(shields, maxShields);
-	double maxHull = attributes.Get("hull");
+	double maxHull = attributes.Get(HULL);
 	hull = min(hull, maxHull);
 	
 	int requiredCrew = RequiredCrew();
@@ -766,27 +832,27 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 		// ship has no ramscoop, it can harvest a tiny bit of fuel by flying
 		// close to the star.
 		double scale = .2 + 1.8 / (.001 * position.Length() + 1);
-		fuel += .03 * scale * (sqrt(attributes.Get("ramscoop")) + .05 * scale);
-		fuel = min(fuel, attributes.Get("fuel capacity"));
+		fuel += .03 * scale * (sqrt(attributes.Get(RAMSCOOP)) + .05 * scale);
+		fuel = min(fuel, attributes.Get(FUEL_CAPACITY));
 		
-		energy += scale * attributes.Get("solar collection");
+		energy += scale * attributes.Get(SOLAR_COLLECTION);
 		
 		double coolingEfficiency = CoolingEfficiency();
-		energy += attributes.Get("energy generation") - attributes.Get("energy consumption");
+		energy += attributes.Get(ENERGY_GENERATION) - attributes.Get(ENERGY_CONSUMPTION);
 		energy -= ionization;
 		energy = max(0., energy);
-		heat += attributes.Get("heat generation");
-		heat -= coolingEfficiency * attributes.Get("cooling");
+		heat += attributes.Get(HEAT_GENERATION);
+		heat -= coolingEfficiency * attributes.Get(COOLING);
 		heat = max(0., heat);
 		
 		// Apply active cooling. The fraction of full cooling to apply equals
 		// your ship's current fraction of its maximum temperature.
-		double activeCooling = coolingEfficiency * attributes.Get("active cooling");
+		double activeCooling = coolingEfficiency * attributes.Get(ACTIVE_COOLING);
 		if(activeCooling > 0.)
 		{
 			// Although it's a misuse of this feature, handle the case where
 			// "active cooling" does not require any energy.
-			double coolingEnergy = attributes.Get("cooling energy");
+			double coolingEnergy = attributes.Get(COOLING_ENERGY);
 			if(coolingEnergy)
 			{
 				double spentEnergy = min(energy, coolingEnergy * min(1., Heat()));
@@ -810,15 +876,15 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 		if(!cloak)
 			cloakDisruption = max(0., cloakDisruption - 1.);
 		
-		double cloakingSpeed = attributes.Get("cloak");
+		double cloakingSpeed = attributes.Get(CLOAK);
 		bool canCloak = (!isDisabled && cloakingSpeed > 0. && !cloakDisruption
-			&& fuel >= attributes.Get("cloaking fuel")
-			&& energy >= attributes.Get("cloaking energy"));
+			&& fuel >= attributes.Get(CLOAKING_FUEL)
+			&& energy >= attributes.Get(CLOAKING_ENERGY));
 		if(commands.Has(Command::CLOAK) && canCloak)
 		{
 			cloak = min(1., cloak + cloakingSpeed);
-			fuel -= attributes.Get("cloaking fuel");
-			energy -= attributes.Get("cloaking energy");
+			fuel -= attributes.Get(CLOAKING_FUEL);
+			energy -= attributes.Get(CLOAKING_ENERGY);
 		}
 		else if(cloakingSpeed)
 		{
@@ -847,7 +913,7 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 				double size = Width() + Height();
 				double scale = .03 * size + .5;
 				double radius = .2 * size;
-				int debrisCount = attributes.Get("mass") * .07;
+				int debrisCount = attributes.Get(MASS) * .07;
 				for(int i = 0; i < debrisCount; ++i)
 				{
 					effects.push_back(*effect);
@@ -1041,7 +1107,7 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 			}
 		}
 		// Only refuel if this planet has a spaceport.
-		else if(fuel == attributes.Get("fuel capacity")
+		else if(fuel == attributes.Get(FUEL_CAPACITY)
 				|| !landingPlanet || !landingPlanet->HasSpaceport())
 		{
 			zoom = min(1., zoom + .02);
@@ -1049,7 +1115,7 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 			landingPlanet = nullptr;
 		}
 		else
-			fuel = min(fuel + 1., attributes.Get("fuel capacity"));
+			fuel = min(fuel + 1., attributes.Get(FUEL_CAPACITY));
 		
 		// Move the ship at the velocity it had when it began landing, but
 		// scaled based on how small it is now.
@@ -1067,7 +1133,7 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 	else if(commands.Has(Command::JUMP) && IsReadyToJump())
 	{
 		hyperspaceSystem = GetTargetSystem();
-		isUsingJumpDrive = !attributes.Get("hyperdrive") || !currentSystem->Links().count(hyperspaceSystem);
+		isUsingJumpDrive = !attributes.Get(HYPERDRIVE) || !currentSystem->Links().count(hyperspaceSystem);
 		hyperspaceFuelCost = JumpFuel(hyperspaceSystem);
 	}
 	
@@ -1082,7 +1148,7 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 	else if(requiredCrew && static_cast<int>(Random::Int(requiredCrew)) >= Crew())
 	{
 		pilotError = 30;
-		if(parent.lock() || !government->IsPlayer())
+		if(parent || !government->IsPlayer())
 			Messages::Add(name + " is moving erratically because there are not enough crew to pilot it.");
 		else
 			Messages::Add("Your ship is moving erratically because you do not have enough crew to pilot it.");
@@ -1094,13 +1160,13 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 	// disabled, all it can do is slow down to a stop.
 	double mass = Mass();
 	if(isDisabled)
-		velocity *= 1. - attributes.Get("drag") / mass;
+		velocity *= 1. - attributes.Get(DRAG) / mass;
 	else if(!pilotError)
 	{
 		if(commands.Turn())
 		{
 			// Check if we are able to turn.
-			double cost = attributes.Get("turning energy");
+			double cost = attributes.Get(TURNING_ENERGY);
 			if(energy < cost * fabs(commands.Turn()))
 				commands.SetTurn(commands.Turn() * energy / (cost * fabs(commands.Turn())));
 			
@@ -1111,7 +1177,7 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 				// of the turning energy and produce a fraction of the heat.
 				double scale = fabs(commands.Turn());
 				energy -= scale * cost;
-				heat += scale * attributes.Get("turning heat");
+				heat += scale * attributes.Get(TURNING_HEAT);
 				angle += commands.Turn() * TurnRate() * slowMultiplier;
 			}
 		}
@@ -1121,7 +1187,7 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 		{
 			// Check if we are able to apply this thrust.
 			double cost = attributes.Get((thrustCommand > 0.) ?
-				"thrusting energy" : "reverse thrusting energy");
+				THRUSTING_ENERGY : REVERSE_THRUSTING_ENERGY);
 			if(energy < cost)
 				thrustCommand *= energy / cost;
 			
@@ -1130,12 +1196,12 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 				// If a reverse thrust is commanded and the capability does not
 				// exist, ignore it (do not even slow under drag).
 				isThrusting = (thrustCommand > 0.);
-				thrust = attributes.Get(isThrusting ? "thrust" : "reverse thrust");
+				thrust = attributes.Get(isThrusting ? THRUST : REVERSE_THRUST);
 				if(thrust)
 				{
 					double scale = fabs(thrustCommand);
 					energy -= scale * cost;
-					heat += scale * attributes.Get(isThrusting ? "thrusting heat" : "reverse thrusting heat");
+					heat += scale * attributes.Get(isThrusting ? THRUSTING_HEAT : REVERSE_THRUSTING_HEAT);
 					acceleration += angle.Unit() * (thrustCommand * thrust / mass);
 				}
 			}
@@ -1144,12 +1210,12 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 				&& !CannotAct();
 		if(applyAfterburner)
 		{
-			thrust = attributes.Get("afterburner thrust");
-			double cost = attributes.Get("afterburner fuel");
-			double energyCost = attributes.Get("afterburner energy");
+			thrust = attributes.Get(AFTERBURNER_THRUST);
+			double cost = attributes.Get(AFTERBURNER_FUEL);
+			double energyCost = attributes.Get(AFTERBURNER_ENERGY);
 			if(thrust && fuel >= cost && energy >= energyCost)
 			{
-				heat += attributes.Get("afterburner heat");
+				heat += attributes.Get(AFTERBURNER_HEAT);
 				fuel -= cost;
 				energy -= energyCost;
 				acceleration += angle.Unit() * thrust / mass;
@@ -1171,7 +1237,7 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 	if(acceleration)
 	{
 		acceleration *= slowMultiplier;
-		Point dragAcceleration = acceleration - velocity * (attributes.Get("drag") / mass);
+		Point dragAcceleration = acceleration - velocity * (attributes.Get(DRAG) / mass);
 		// Make sure dragAcceleration has nonzero length, to avoid divide by zero.
 		if(dragAcceleration)
 		{
@@ -1208,7 +1274,7 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 	// moment, its boarding target should be its parent ship.
 	if(CanBeCarried() && !(target && target == GetShipToAssist()))
 		target = GetParent();
-	if(target && !isDisabled)
+	if(target && !isDisabled && (isBoarding || commands.Has(Command::BOARD)))
 	{
 		Point dp = (target->position - position);
 		double distance = dp.Length();
@@ -1254,11 +1320,11 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 				{
 					isBoarding = false;
 					bool isEnemy = government->IsEnemy(target->government);
-					if(isEnemy && Random::Real() < target->Attributes().Get("self destruct"))
+					if(isEnemy && Random::Real() < target->Attributes().Get(SELF_DESTRUCT))
 					{
 						Messages::Add("The " + target->ModelName() + " \"" + target->Name()
 							+ "\" has activated its self-destruct mechanism.");
-						targetShip.lock()->SelfDestruct();
+						targetShip.Get()->SelfDestruct();
 					}
 					else
 						hasBoarded = true;
@@ -1273,33 +1339,27 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 	{
 		// Recharge is limited by available energy. Extra recharge capacity can
 		// be used on fighters this ship is carrying.
-		double hullRate = attributes.Get("hull repair rate");
+		double hullRate = attributes.Get(HULL_REPAIR_RATE);
 		if(hullRate > 0.)
 		{
-			double hullEnergy = attributes.Get("hull energy");
-			double hullHeat = attributes.Get("hull heat");
+			double hullEnergy = attributes.Get(HULL_ENERGY);
+			double hullHeat = attributes.Get(HULL_HEAT);
 			double hullAdded = AddHull(hullRate * min(1., hullEnergy ? energy / hullEnergy : 1.));
 			energy -= hullEnergy * hullAdded / hullRate;
 			heat += hullHeat * hullAdded / hullRate;
 		}
 		
-		double shieldRate = attributes.Get("shield generation");
+		double shieldRate = attributes.Get(SHIELD_GENERATION);
 		if(shieldRate > 0.)
 		{
-			double shieldEnergy = attributes.Get("shield energy");
-			double shieldHeat = attributes.Get("shield heat");
+			double shieldEnergy = attributes.Get(SHIELD_ENERGY);
+			double shieldHeat = attributes.Get(SHIELD_HEAT);
 			double shieldsAdded = AddShields(shieldRate * min(1., shieldEnergy ? energy / shieldEnergy : 1.));
 			energy -= shieldEnergy * shieldsAdded / shieldRate;
 			heat += shieldHeat * shieldsAdded / shieldRate;
 		}
 	}
 	
-	// Clear your target if it is destroyed. This is only important for NPCs,
-	// because ordinary ships cease to exist once they are destroyed.
-	target = targetShip.lock();
-	if(target && target->IsDestroyed() && target->explosionCount >= target->explosionTotal)
-		targetShip.reset();
-	
 	// And finally: move the ship!
 	position += velocity;
 	
@@ -1308,6 +1368,32 @@ bool Ship::Move(list<Effect> &effects, list<shared_ptr<Flotsam>> &flotsam)
 
 
 
+// Check if this ship can move without reading or changing any other ship.
+bool Ship::MovesAlone() const
+{
+	// A ship arriving from hyperspace may aim for its parent's target planet,
+	// and keeps track of where it is relative to its parent.
+	if((hyperspaceSystem || hyperspaceCount) && parent)
+		return false;
+	
+	// A ship that is boarding moves toward its target and may trigger its
+	// self-destruct mechanism.
+	return !isBoarding && !commands.Has(Command::BOARD);
+}
+
+
+
+// Clear your target if it is destroyed. This is only important for NPCs,
+// because ordinary ships cease to exist once they are destroyed.
+void Ship::ForgetDestroyedTarget()
+{
+	const Ship *target = targetShip.Get();
+	if(target && target->IsDestroyed() && target->explosionCount >= target->explosionTotal)
+		targetShip = ShipHandle();
+}
+
+
+
 // Launch any ships that are ready to launch.
 void Ship::Launch(list<shared_ptr<Ship>> &ships)
 {
@@ -1415,10 +1501,10 @@ int Ship::Scan()
 		return 0;
 	
 	// The range of a scanner is proportional to the square root of its power.
-	double cargoPower = attributes.Get("cargo scan power");
-	double cargoDistance = cargoPower ? 100. * sqrt(cargoPower) : attributes.Get("cargo scan");
-	double outfitPower = attributes.Get("outfit scan power");
-	double outfitDistance = outfitPower ? 100. * sqrt(outfitPower) : attributes.Get("outfit scan");
+	double cargoPower = attributes.Get(CARGO_SCAN_POWER);
+	double cargoDistance = cargoPower ? 100. * sqrt(cargoPower) : attributes.Get(CARGO_SCAN);
+	double outfitPower = attributes.Get(OUTFIT_SCAN_POWER);
+	double outfitDistance = outfitPower ? 100. * sqrt(outfitPower) : attributes.Get(OUTFIT_SCAN);
 	
 	// Bail out if this ship has no scanners.
 	if(!cargoDistance && !outfitDistance)
@@ -1426,10 +1512,10 @@ int Ship::Scan()
 	
 	// Scanning speed also uses a square root, so you need four scanners to get
 	// twice the speed out of them.
-	double cargoSpeed = sqrt(attributes.Get("cargo scan speed"));
+	double cargoSpeed = sqrt(attributes.Get(CARGO_SCAN_SPEED));
 	if(!cargoSpeed)
 		cargoSpeed = 1.;
-	double outfitSpeed = sqrt(attributes.Get("outfit scan speed"));
+	double outfitSpeed = sqrt(attributes.Get(OUTFIT_SCAN_SPEED));
 	if(!outfitSpeed)
 		outfitSpeed = 1.;
 	
@@ -1514,7 +1600,7 @@ double Ship::OutfitScanFraction() const
 // Fire any weapons that are ready to fire. If an anti-missile is ready,
 // instead of firing here this function returns true and it can be fired if
 // collision detection finds a missile in range.
-bool Ship::Fire(list<Projectile> &projectiles, list<Effect> &effects)
+bool Ship::Fire(vector<Projectile> &projectiles, vector<Effect> &effects)
 {
 	isInSystem = true;
 	forget = 0;
@@ -1550,7 +1636,7 @@ bool Ship::Fire(list<Projectile> &projectiles, list<Effect> &effects)
 
 
 // Fire an anti-missile.
-bool Ship::FireAntiMissile(const Projectile &projectile, list<Effect> &effects)
+bool Ship::FireAntiMissile(const Projectile &projectile, vector<Effect> &effects)
 {
 	if(projectile.Position().Distance(position) > antiMissileRange)
 		return false;
@@ -1699,8 +1785,8 @@ bool Ship::IsReadyToJump() const
 		return false;
 	
 	Point direction = targetSystem->Position() - currentSystem->Position();
-	bool isJump = !attributes.Get("hyperdrive") || !currentSystem->Links().count(targetSystem);
-	double scramThreshold = attributes.Get("scram drive");
+	bool isJump = !attributes.Get(HYPERDRIVE) || !currentSystem->Links().count(targetSystem);
+	double scramThreshold = attributes.Get(SCRAM_DRIVE);
 	
 	// The ship can only enter hyperspace if it is traveling slowly enough
 	// and pointed in the right direction.
@@ -1710,7 +1796,7 @@ bool Ship::IsReadyToJump() const
 		if(deviation > scramThreshold)
 			return false;
 	}
-	else if(velocity.Length() > attributes.Get("jump speed"))
+	else if(velocity.Length() > attributes.Get(JUMP_SPEED))
 		return false;
 	
 	if(!isJump)
@@ -1792,18 +1878,18 @@ void Ship::Recharge(bool atSpaceport)
 	
 	if(atSpaceport)
 	{
-		crew = min<int>(max(crew, RequiredCrew()), attributes.Get("bunks"));
-		fuel = attributes.Get("fuel capacity");
+		crew = min<int>(max(crew, RequiredCrew()), attributes.Get(BUNKS));
+		fuel = attributes.Get(FUEL_CAPACITY);
 	}
 	pilotError = 0;
 	pilotOkay = 0;
 	
-	if(atSpaceport || attributes.Get("shield generation"))
-		shields = attributes.Get("shields");
-	if(atSpaceport || attributes.Get("hull repair rate"))
-		hull = attributes.Get("hull");
-	if(atSpaceport || attributes.Get("energy generation"))
-		energy = attributes.Get("energy capacity");
+	if(atSpaceport || attributes.Get(SHIELD_GENERATION))
+		shields = attributes.Get(SHIELDS);
+	if(atSpaceport || attributes.Get(HULL_REPAIR_RATE))
+		hull = attributes.Get(HULL);
+	if(atSpaceport || attributes.Get(ENERGY_GENERATION))
+		energy = attributes.Get(ENERGY_CAPACITY);
 	
 	heat = IdleHeat();
 	ionization = 0.;
@@ -1822,10 +1908,10 @@ bool Ship::CanRefuel(const Ship &other) const
 
 double Ship::TransferFuel(double amount, Ship *to)
 {
-	amount = max(fuel - attributes.Get("fuel capacity"), amount);
+	amount = max(fuel - attributes.Get(FUEL_CAPACITY), amount);
 	if(to)
 	{
-		amount = min(to->attributes.Get("fuel capacity") - to->fuel, amount);
+		amount = min(to->attributes.Get(FUEL_CAPACITY) - to->fuel, amount);
 		to->fuel += amount;
 	}
 	fuel -= amount;
@@ -1859,7 +1945,7 @@ void Ship::WasCaptured(const shared_ptr<Ship> &capturer)
 	SetTargetShip(shared_ptr<Ship>());
 	SetTargetStellar(nullptr);
 	SetTargetSystem(nullptr);
-	shipToAssist.reset();
+	shipToAssist = ShipHandle();
 	commands.Clear();
 	isDisabled = false;
 	hyperspaceSystem = nullptr;
@@ -1874,11 +1960,11 @@ void Ship::WasCaptured(const shared_ptr<Ship> &capturer)
 		if(bay.ship)
 			bay.ship->WasCaptured(capturer);
 	// If a flagship is captured, its escorts become independent.
-	for(const auto &it : escorts)
+	for(const ShipHandle &it : escorts)
 	{
-		shared_ptr<Ship> escort = it.lock();
+		Ship *escort = it.Get();
 		if(escort)
-			escort->parent.reset();
+			escort->parent = ShipHandle();
 	}
 }
 
@@ -1887,7 +1973,7 @@ void Ship::WasCaptured(const shared_ptr<Ship> &capturer)
 // Get characteristics of this ship, as a fraction between 0 and 1.
 double Ship::Shields() const
 {
-	double maximum = attributes.Get("shields");
+	double maximum = attributes.Get(SHIELDS);
 	return maximum ? min(1., shields / maximum) : 0.;
 }
 
@@ -1895,7 +1981,7 @@ double Ship::Shields() const
 
 double Ship::Hull() const
 {
-	double maximum = attributes.Get("hull");
+	double maximum = attributes.Get(HULL);
 	return maximum ? min(1., hull / maximum) : 1.;
 }
 
@@ -1903,7 +1989,7 @@ double Ship::Hull() const
 
 double Ship::Energy() const
 {
-	double maximum = attributes.Get("energy capacity");
+	double maximum = attributes.Get(ENERGY_CAPACITY);
 	return maximum ? min(1., energy / maximum) : (hull > 0.) ? 1. : 0.;
 }
 
@@ -1919,7 +2005,7 @@ double Ship::Heat() const
 
 double Ship::Fuel() const
 {
-	double maximum = attributes.Get("fuel capacity");
+	double maximum = attributes.Get(FUEL_CAPACITY);
 	return maximum ? min(1., fuel / maximum) : 0.;
 }
 
@@ -1942,10 +2028,10 @@ double Ship::JumpFuel(const System *destination) const
 		return max(JumpDriveFuel(), HyperdriveFuel());
 	
 	// Figure out what sort of jump we're making.
-	if(attributes.Get("hyperdrive") && currentSystem->Links().count(destination))
+	if(attributes.Get(HYPERDRIVE) && currentSystem->Links().count(destination))
 		return HyperdriveFuel();
 	
-	if(attributes.Get("jump drive") && currentSystem->Neighbors().count(destination))
+	if(attributes.Get(JUMP_DRIVE) && currentSystem->Neighbors().count(destination))
 		return JumpDriveFuel();
 	
 	// If the given system is not a possible destination, return 0.
@@ -1957,25 +2043,14 @@ double Ship::JumpFuel(const System *destination) const
 // Get the cost of making a jump of the given type (if possible).
 double Ship::HyperdriveFuel() const
 {
-	// Don't bother searching through the outfits if there is no hyperdrive.
-	if(!attributes.Get("hyperdrive"))
-		return JumpDriveFuel();
-	
-	if(attributes.Get("scram drive"))
-		return BestFuel("hyperdrive", "scram drive", 150.);
-	
-	return BestFuel("hyperdrive", "", 100.);
+	return stats.hyperdriveFuel;
 }
 
 
 
 double Ship::JumpDriveFuel() const
 {
-	// Don't bother searching through the outfits if there is no jump drive.
-	if(!attributes.Get("jump drive"))
-		return 0.;
-	
-	return BestFuel("jump drive", "", 200.);
+	return stats.jumpDriveFuel;
 }
 
 
@@ -1985,7 +2060,7 @@ double Ship::JumpFuelMissing() const
 	// Used for smart refuelling: transfer only as much as really needed
 	// includes checking if fuel cap is high enough at all
 	double jumpFuel = JumpFuel(targetSystem);
-	if(!jumpFuel || fuel > jumpFuel || jumpFuel > attributes.Get("fuel capacity"))
+	if(!jumpFuel || fuel > jumpFuel || jumpFuel > attributes.Get(FUEL_CAPACITY))
 		return 0.;
 	
 	return jumpFuel - fuel;
@@ -1996,18 +2071,12 @@ double Ship::JumpFuelMissing() const
 // Get the heat level at idle.
 double Ship::IdleHeat() const
 {
-	// This ship's cooling ability:
-	double coolingEfficiency = CoolingEfficiency();
-	double cooling = coolingEfficiency * attributes.Get("cooling");
-	double activeCooling = coolingEfficiency * attributes.Get("active cooling");
-	
 	// Idle heat is the heat level where:
 	// heat = heat * diss + heatGen - cool - activeCool * heat / (100 * mass)
 	// heat = heat * (diss - activeCool / (100 * mass)) + (heatGen - cool)
 	// heat * (1 - diss + activeCool / (100 * mass)) = (heatGen - cool)
-	double production = max(0., attributes.Get("heat generation") - cooling);
-	double dissipation = .001 * attributes.Get("heat dissipation") + activeCooling / (100. * Mass());
-	return production / dissipation;
+	double dissipation = stats.heatDissipation + stats.activeCooling / (100. * Mass());
+	return stats.heatProduction / dissipation;
 }
 
 
@@ -2015,11 +2084,7 @@ double Ship::IdleHeat() const
 // Calculate the multiplier for cooling efficiency.
 double Ship::CoolingEfficiency() const
 {
-	// This is an S-curve where the efficiency is 100% if you have no outfits
-	// that create "cooling inefficiency", and as that value increases the
-	// efficiency stays high for a while, then drops off, then approaches 0.
-	double x = attributes.Get("cooling inefficiency");
-	return 2. + 2. / (1. + exp(x / -2.)) - 4. / (1. + exp(x / -4.));
+	return stats.coolingEfficiency;
 }
 
 
@@ -2033,18 +2098,14 @@ int Ship::Crew() const
 
 int Ship::RequiredCrew() const
 {
-	if(attributes.Get("automaton"))
-		return 0;
-	
-	// Drones do not need crew, but all other ships need at least one.
-	return max<int>(1, attributes.Get("required crew"));
+	return stats.requiredCrew;
 }
 
 
 
 void Ship::AddCrew(int count)
 {
-	crew = min<int>(crew + count, attributes.Get("bunks"));
+	crew = min<int>(crew + count, attributes.Get(BUNKS));
 }
 
 
@@ -2063,33 +2124,28 @@ double Ship::Mass() const
 	for(const Bay &bay : bays)
 		if(bay.ship)
 			carried += bay.ship->Mass();
-	return carried + cargo.Used() + attributes.Get("mass");
+	return carried + cargo.Used() + stats.mass;
 }
 
 
 
 double Ship::TurnRate() const
 {
-	return attributes.Get("turn") / Mass();
+	return stats.turn / Mass();
 }
 
 
 
 double Ship::Acceleration() const
 {
-	double thrust = attributes.Get("thrust");
-	return (thrust ? thrust : attributes.Get("afterburner thrust")) / Mass();
+	return stats.thrust / Mass();
 }
 
 
 
 double Ship::MaxVelocity() const
 {
-	// v * drag / mass == thrust / mass
-	// v * drag == thrust
-	// v = thrust / drag
-	double thrust = attributes.Get("thrust");
-	return (thrust ? thrust : attributes.Get("afterburner thrust")) / attributes.Get("drag");
+	return stats.maxVelocity;
 }
 
 
@@ -2193,9 +2249,9 @@ bool Ship::CanCarry(const Ship &ship) const
 	if(!free)
 		return false;
 	
-	for(const auto &it : escorts)
+	for(const ShipHandle &it : escorts)
 	{
-		auto escort = it.lock();
+		const Ship *escort = it.Get();
 		if(escort && escort->attributes.Category() == ship.attributes.Category())
 			--free;
 	}
@@ -2318,7 +2374,7 @@ void Ship::Jettison(const Outfit *outfit, int count)
 	
 	// Jettisoned cargo must carry some of the ship's heat with it. Otherwise
 	// jettisoning cargo would increase the ship's temperature.
-	double mass = outfit->Get("mass");
+	double mass = outfit->Get(MASS);
 	double shipMass = Mass();
 	heat *= shipMass / (shipMass + count * mass);
 	
@@ -2377,13 +2433,14 @@ void Ship::AddOutfit(const Outfit *outfit, int count)
 				outfits.erase(it);
 		}
 		attributes.Add(*outfit, count);
+		stats = CalculateStats();
 		if(outfit->IsWeapon())
 			armament.Add(outfit, count);
 		
-		if(outfit->Get("cargo space"))
-			cargo.SetSize(attributes.Get("cargo space"));
-		if(outfit->Get("hull"))
-			hull += outfit->Get("hull") * count;
+		if(outfit->Get(CARGO_SPACE))
+			cargo.SetSize(attributes.Get(CARGO_SPACE));
+		if(outfit->Get(HULL))
+			hull += outfit->Get(HULL) * count;
 	}
 }
 
@@ -2448,14 +2505,16 @@ void Ship::ExpendAmmo(const Outfit *outfit)
 // land on) and a target ship (to move to, and attack if hostile).
 shared_ptr<Ship> Ship::GetTargetShip() const
 {
-	return targetShip.lock();
+	Ship *ship = targetShip.Get();
+	return ship ? ship->shared_from_this() : shared_ptr<Ship>();
 }
 
 
 
 shared_ptr<Ship> Ship::GetShipToAssist() const
 {
-	return shipToAssist.lock();
+	Ship *ship = shipToAssist.Get();
+	return ship ? ship->shared_from_this() : shared_ptr<Ship>();
 }
 
 
@@ -2492,9 +2551,9 @@ shared_ptr<Flotsam> Ship::GetTargetFlotsam() const
 // Set this ship's targets.
 void Ship::SetTargetShip(const shared_ptr<Ship> &ship)
 {
-	if(ship != targetShip.lock())
+	if(ship.get() != targetShip.Get())
 	{
-		targetShip = ship;
+		targetShip = ship.get();
 		// When you change targets, clear your scanning records.
 		cargoScan = 0.;
 		outfitScan = 0.;
@@ -2505,7 +2564,7 @@ void Ship::SetTargetShip(const shared_ptr<Ship> &ship)
 
 void Ship::SetShipToAssist(const shared_ptr<Ship> &ship)
 {
-	shipToAssist = ship;
+	shipToAssist = ship.get();
 }
 
 
@@ -2541,11 +2600,11 @@ void Ship::SetTargetFlotsam(const shared_ptr<Flotsam> &flotsam)
 
 void Ship::SetParent(const shared_ptr<Ship> &ship)
 {
-	shared_ptr<Ship> oldParent = parent.lock();
+	Ship *oldParent = parent.Get();
 	if(oldParent)
 		oldParent->RemoveEscort(*this);
 	
-	parent = ship;
+	parent = ship.get();
 	if(ship)
 		ship->AddEscort(*this);
 }
@@ -2554,23 +2613,46 @@ void Ship::SetParent(const shared_ptr<Ship> &ship)
 
 shared_ptr<Ship> Ship::GetParent() const
 {
-	return parent.lock();
+	Ship *ship = parent.Get();
+	return ship ? ship->shared_from_this() : shared_ptr<Ship>();
 }
 
 
 
-const vector<weak_ptr<Ship>> &Ship::GetEscorts() const
+const vector<ShipHandle> &Ship::GetEscorts() const
 {
 	return escorts;
 }
 
 
 
+// Get this ship's target, parent, etc. without touching reference counts.
+Ship *Ship::TargetShip() const
+{
+	return targetShip.Get();
+}
+
+
+
+Ship *Ship::ShipToAssist() const
+{
+	return shipToAssist.Get();
+}
+
+
+
+Ship *Ship::Parent() const
+{
+	return parent.Get();
+}
+
+
+
 // Add escorts to this ship. Escorts look to the parent ship for movement
 // cues and try to stay with it when it lands or goes into hyperspace.
 void Ship::AddEscort(Ship &ship)
 {
-	escorts.push_back(ship.shared_from_this());
+	escorts.emplace_back(&ship);
 }
 
 
@@ -2579,7 +2661,7 @@ void Ship::RemoveEscort(const Ship &ship)
 {
 	auto it = escorts.begin();
 	for( ; it != escorts.end(); ++it)
-		if(it->lock().get() == &ship)
+		if(it->Get() == &ship)
 		{
 			escorts.erase(it);
 			return;
@@ -2593,7 +2675,7 @@ double Ship::MinimumHull() const
 	if(neverDisabled)
 		return 0.;
 	
-	double maximumHull = attributes.Get("hull");
+	double maximumHull = attributes.Get(HULL);
 	return max(.20 * maximumHull, min(.50 * maximumHull, 400.));
 }
 
@@ -2603,7 +2685,7 @@ double Ship::MinimumHull() const
 // ship is carrying fighters, add to them as well.
 double Ship::AddHull(double rate)
 {
-	double added = min(rate, attributes.Get("hull") - hull);
+	double added = min(rate, attributes.Get(HULL) - hull);
 	hull += added;
 	rate -= added;
 	
@@ -2612,8 +2694,8 @@ double Ship::AddHull(double rate)
 		if(!bay.ship)
 			continue;
 		
-		double myGen = bay.ship->Attributes().Get("hull repair rate");
-		double myMax = bay.ship->Attributes().Get("hull");
+		double myGen = bay.ship->Attributes().Get(HULL_REPAIR_RATE);
+		double myMax = bay.ship->Attributes().Get(HULL);
 		bay.ship->hull = min(myMax, bay.ship->hull + myGen);
 		if(rate > 0. && bay.ship->hull < myMax)
 		{
@@ -2630,7 +2712,7 @@ double Ship::AddHull(double rate)
 
 double Ship::AddShields(double rate)
 {
-	double added = min(rate, attributes.Get("shields") - shields);
+	double added = min(rate, attributes.Get(SHIELDS) - shields);
 	shields += added;
 	rate -= added;
 	
@@ -2639,8 +2721,8 @@ double Ship::AddShields(double rate)
 		if(!bay.ship)
 			continue;
 		
-		double myGen = bay.ship->Attributes().Get("shield generation");
-		double myMax = bay.ship->Attributes().Get("shields");
+		double myGen = bay.ship->Attributes().Get(SHIELD_GENERATION);
+		double myMax = bay.ship->Attributes().Get(SHIELDS);
 		bay.ship->shields = min(myMax, bay.ship->shields + myGen);
 		if(rate > 0. && bay.ship->shields < myMax)
 		{
@@ -2663,7 +2745,7 @@ double Ship::BestFuel(const string &type, const string &subtype, double defaultF
 	// Make it possible for a hyperdrive to be integrated into a ship.
 	if(baseAttributes.Get(type) && (subtype.empty() || baseAttributes.Get(subtype)))
 	{
-		best = baseAttributes.Get("jump fuel");
+		best = baseAttributes.Get(JUMP_FUEL);
 		if(!best)
 			best = defaultFuel;
 	}
@@ -2671,7 +2753,7 @@ double Ship::BestFuel(const string &type, const string &subtype, double defaultF
 	for(const auto &it : outfits)
 		if(it.first->Get(type) && (subtype.empty() || it.first->Get(subtype)))
 		{
-			double fuel = it.first->Get("jump fuel");
+			double fuel = it.first->Get(JUMP_FUEL);
 			if(!fuel)
 				fuel = defaultFuel;
 			if(!best || fuel < best)
@@ -2682,7 +2764,73 @@ double Ship::BestFuel(const string &type, const string &subtype, double defaultF
 
 
 
-void Ship::CreateExplosion(list<Effect> &effects, bool spread)
+// Calculate the statistics that are derived from the attributes and outfits.
+Ship::Stats Ship::CalculateStats() const
+{
+	Stats result;
+	result.mass = attributes.Get(MASS);
+	result.turn = attributes.Get(TURN);
+	
+	// v * drag / mass == thrust / mass
+	// v * drag == thrust
+	// v = thrust / drag
+	double thrust = attributes.Get(THRUST);
+	result.thrust = thrust ? thrust : attributes.Get(AFTERBURNER_THRUST);
+	result.maxVelocity = result.thrust / attributes.Get(DRAG);
+	
+	// This is an S-curve where the efficiency is 100% if you have no outfits
+	// that create "cooling inefficiency", and as that value increases the
+	// efficiency stays high for a while, then drops off, then approaches 0.
+	double x = attributes.Get(COOLING_INEFFICIENCY);
+	result.coolingEfficiency = 2. + 2. / (1. + exp(x / -2.)) - 4. / (1. + exp(x / -4.));
+	double cooling = result.coolingEfficiency * attributes.Get(COOLING);
+	result.activeCooling = result.coolingEfficiency * attributes.Get(ACTIVE_COOLING);
+	result.heatProduction = max(0., attributes.Get(HEAT_GENERATION) - cooling);
+	result.heatDissipation = .001 * attributes.Get(HEAT_DISSIPATION);
+	
+	// Drones do not need crew, but all other ships need at least one.
+	result.requiredCrew = attributes.Get(AUTOMATON) ? 0 : max<int>(1, attributes.Get(REQUIRED_CREW));
+	
+	// Don't bother searching through the outfits if there is no jump drive
+	// or hyperdrive.
+	if(attributes.Get(JUMP_DRIVE))
+		result.jumpDriveFuel = BestFuel("jump drive", "", 200.);
+	if(!attributes.Get(HYPERDRIVE))
+		result.hyperdriveFuel = result.jumpDriveFuel;
+	else if(attributes.Get(SCRAM_DRIVE))
+		result.hyperdriveFuel = BestFuel("hyperdrive", "scram drive", 150.);
+	else
+		result.hyperdriveFuel = BestFuel("hyperdrive", "", 100.);
+	
+	return result;
+}
+
+
+
+// Check that the cached statistics match what the attributes say they should
+// be. If not, some code that changes the attributes forgot to update them.
+void Ship::CheckStats() const
+{
+	// Values that are not a number (like the top speed of a ship with no
+	// thrust or drag) never compare equal, so treat those as matching.
+	auto differs = [](double a, double b) { return a != b && !(std::isnan(a) && std::isnan(b)); };
+	
+	Stats expected = CalculateStats();
+	if(differs(expected.mass, stats.mass) || differs(expected.turn, stats.turn)
+			|| differs(expected.thrust, stats.thrust) || differs(expected.maxVelocity, stats.maxVelocity)
+			|| differs(expected.coolingEfficiency, stats.coolingEfficiency)
+			|| differs(expected.heatProduction, stats.heatProduction)
+			|| differs(expected.heatDissipation, stats.heatDissipation)
+			|| differs(expected.activeCooling, stats.activeCooling)
+			|| expected.requiredCrew != stats.requiredCrew
+			|| differs(expected.hyperdriveFuel, stats.hyperdriveFuel)
+			|| differs(expected.jumpDriveFuel, stats.jumpDriveFuel))
+		cerr << "Derived statistics are out of date for " << modelName << " \"" << name << "\"" << endl;
+}
+
+
+
+void Ship::CreateExplosion(vector<Effect> &effects, bool spread)
 {
 	if(!HasSprite() || !GetMask().IsLoaded() || explosionEffects.empty())
 		return;
@@ -2720,7 +2868,7 @@ void Ship::CreateExplosion(list<Effect> &effects, bool spread)
 
 
 // Place a "spark" effect, like ionization or disruption.
-void Ship::CreateSparks(list<Effect> &effects, const string &name, double amount)
+void Ship::CreateSparks(vector<Effect> &effects, const string &name, double amount)
 {
 	if(forget)
 		return;
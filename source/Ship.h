@@ -23,6 +23,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Outfit.h"
 #include "Personality.h"
 #include "Point.h"
+#include "ShipHandle.h"
 
 #include <list>
 #include <map>
@@ -151,7 +152,13 @@ public:
 	// Move this ship. A ship may create effects as it moves, in particular if
 	// it is in the process of blowing up. If this returns false, the ship
 	// should be deleted.
-	bool Move(std::list<Effect> &effects, std::list<std::shared_ptr<Flotsam>> &flotsam);
+	bool Move(std::vector<Effect> &effects, std::list<std::shared_ptr<Flotsam>> &flotsam);
+	// Check if this ship can move without reading or changing any other ship.
+	// Ships that are boarding, or following their parent out of hyperspace,
+	// must be moved one at a time; any others can be moved in parallel.
+	bool MovesAlone() const;
+	// Stop targeting a ship once it has been destroyed and finished exploding.
+	void ForgetDestroyedTarget();
 	// Launch any ships that are ready to launch.
 	void Launch(std::list<std::shared_ptr<Ship>> &ships);
 	// Check if this ship is boarding another ship. If it is, it either plunders
@@ -168,9 +175,9 @@ public:
 	// Fire any weapons that are ready to fire. If an anti-missile is ready,
 	// instead of firing here this function returns true and it can be fired if
 	// collision detection finds a missile in range.
-	bool Fire(std::list<Projectile> &projectiles, std::list<Effect> &effects);
+	bool Fire(std::vector<Projectile> &projectiles, std::vector<Effect> &effects);
 	// Fire an anti-missile. Returns true if the missile was killed.
-	bool FireAntiMissile(const Projectile &projectile, std::list<Effect> &effects);
+	bool FireAntiMissile(const Projectile &projectile, std::vector<Effect> &effects);
 	
 	// Get the system this ship is in.
 	const System *GetSystem() const;
@@ -341,7 +348,37 @@ public:
 	// previous parent it had.
 	void SetParent(const std::shared_ptr<Ship> &ship);
 	std::shared_ptr<Ship> GetParent() const;
-	const std::vector<std::weak_ptr<Ship>> &GetEscorts() const;
+	const std::vector<ShipHandle> &GetEscorts() const;
+	
+	// Get the same ships as GetTargetShip(), GetShipToAssist(), and GetParent()
+	// without touching their reference counts. This is much cheaper, but the
+	// pointers should not be kept beyond the current step.
+	Ship *TargetShip() const;
+	Ship *ShipToAssist() const;
+	Ship *Parent() const;
+	
+	
+private:
+	// Statistics that are derived from the ship's attributes and outfits and
+	// that are needed many times each step, so they are only recalculated
+	// when the attributes change. The mass of anything this ship is carrying
+	// is not included, since it changes independently of the outfits.
+	class Stats {
+	public:
+		double mass = 0.;
+		double turn = 0.;
+		double thrust = 0.;
+		double maxVelocity = 0.;
+		double coolingEfficiency = 1.;
+		// Heat production and dissipation at idle, except for the part of the
+		// dissipation from active cooling, which depends on the total mass.
+		double heatProduction = 0.;
+		double heatDissipation = 0.;
+		double activeCooling = 0.;
+		int requiredCrew = 1;
+		double hyperdriveFuel = 0.;
+		double jumpDriveFuel = 0.;
+	};
 	
 	
 private:
@@ -356,11 +393,16 @@ private:
 	double AddShields(double rate);
 	// Find out how much fuel is consumed by the hyperdrive of the given type.
 	double BestFuel(const std::string &type, const std::string &subtype, double defaultFuel) const;
+	// Calculate the derived statistics from the attributes and outfits. They
+	// must be recalculated any time either of those change.
+	Stats CalculateStats() const;
+	// Check that the cached statistics are not out of date.
+	void CheckStats() const;
 	// Create one of this ship's explosions, within its mask. The explosions can
 	// either stay over the ship, or spread out if this is the final explosion.
-	void CreateExplosion(std::list<Effect> &effects, bool spread = false);
+	void CreateExplosion(std::vector<Effect> &effects, bool spread = false);
 	// Place a "spark" effect, like ionization or disruption.
-	void CreateSparks(std::list<Effect> &effects, const std::string &name, double amount);
+	void CreateSparks(std::vector<Effect> &effects, const std::string &name, double amount);
 	
 	
 private:
@@ -415,6 +457,7 @@ private:
 	// Installed outfits, cargo, etc.:
 	Outfit attributes;
 	Outfit baseAttributes;
+	Stats stats;
 	const Outfit *explosionWeapon = nullptr;
 	std::map<const Outfit *, int> outfits;
 	CargoHold cargo;
@@ -463,16 +506,20 @@ private:
 	std::map<const Effect *, int> finalExplosions;
 	
 	// Target ships, planets, systems, etc.
-	std::weak_ptr<Ship> targetShip;
-	std::weak_ptr<Ship> shipToAssist;
+	ShipHandle targetShip;
+	ShipHandle shipToAssist;
 	const StellarObject *targetPlanet = nullptr;
 	const System *targetSystem = nullptr;
 	std::weak_ptr<Minable> targetAsteroid;
 	std::weak_ptr<Flotsam> targetFlotsam;
 	
 	// Links between escorts and parents.
-	std::vector<std::weak_ptr<Ship>> escorts;
-	std::weak_ptr<Ship> parent;
+	std::vector<ShipHandle> escorts;
+	ShipHandle parent;
+	
+	// This ship's place in the registry that handles to it refer to.
+	friend class ShipHandle;
+	ShipHandle::Slot handleSlot;
 };
 
 
@@ -0,0 +1,193 @@
+/* ShipHandle.cpp
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "ShipHandle.h"
+
+#include "Files.h"
+#include "Ship.h"
+
+#include <cassert>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	// A slot is given up by storing a null ship in it and then changing its
+	// generation, so a reader that sees the same generation before and after
+	// reading the ship knows that the ship had not yet been destroyed.
+	class Entry {
+	public:
+		atomic<Ship *> ship{nullptr};
+		atomic<uint32_t> generation{1};
+	};
+	
+	// The registry is stored in fixed-size chunks, which are never moved or
+	// freed, so a handle can be followed without locking even while another
+	// thread is adding a ship to the registry.
+	const uint32_t CHUNK_BITS = 10;
+	const uint32_t CHUNK_SIZE = 1 << CHUNK_BITS;
+	const uint32_t MAX_CHUNKS = 4096;
+	Entry *chunks[MAX_CHUNKS] = {};
+	uint32_t used = 0;
+	vector<uint32_t> unused;
+	// Adding and removing ships must be done one at a time.
+	mutex registryMutex;
+	// The thread that is following handles right now, if any. No other thread
+	// may destroy a ship while it is doing so.
+	atomic<thread::id> followingThread;
+	
+	Entry &GetEntry(uint32_t index)
+	{
+		return chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+	}
+}
+
+
+
+// Give up this ship's place in the registry, so that any handles to it become
+// null and the slot can be reused.
+ShipHandle::Slot::~Slot()
+{
+	uint32_t slot = index.load(memory_order_relaxed);
+	if(!slot)
+		return;
+	
+	// Following a handle does not keep its ship alive, so a ship that handles
+	// may refer to must not be destroyed while another thread follows them.
+	thread::id follower = followingThread.load(memory_order_relaxed);
+	assert(follower == thread::id() || follower == this_thread::get_id());
+	(void)follower;
+	
+	lock_guard<mutex> lock(registryMutex);
+	Entry &entry = GetEntry(slot - 1);
+	entry.ship.store(nullptr, memory_order_release);
+	// Skip generation zero, which marks a null handle.
+	uint32_t generation = entry.generation.load(memory_order_relaxed) + 1;
+	entry.generation.store(generation ? generation : 1, memory_order_release);
+	unused.push_back(slot - 1);
+}
+
+
+
+// Get a handle to the given ship, which may be null.
+ShipHandle::ShipHandle(const Ship *ship)
+{
+	if(!ship)
+		return;
+	
+	atomic<uint32_t> &slot = ship->handleSlot.index;
+	uint32_t value = slot.load(memory_order_acquire);
+	if(!value)
+	{
+		lock_guard<mutex> lock(registryMutex);
+		// Another thread may have added this ship in the meantime.
+		value = slot.load(memory_order_relaxed);
+		if(!value)
+		{
+			if(!unused.empty())
+			{
+				value = unused.back() + 1;
+				unused.pop_back();
+			}
+			else
+			{
+				if((used >> CHUNK_BITS) >= MAX_CHUNKS)
+				{
+					static bool isReported = false;
+					if(!isReported)
+						Files::LogError("Error: too many ships for the ship registry. Some ships will not be able to target or follow others.");
+					isReported = true;
+					return;
+				}
+				if(!(used & (CHUNK_SIZE - 1)))
+					chunks[used >> CHUNK_BITS] = new Entry[CHUNK_SIZE];
+				value = ++used;
+			}
+			GetEntry(value - 1).ship.store(const_cast<Ship *>(ship), memory_order_release);
+			slot.store(value, memory_order_release);
+		}
+	}
+	index = value - 1;
+	generation = GetEntry(index).generation.load(memory_order_acquire);
+}
+
+
+
+// Get the ship this refers to, or null if it no longer exists.
+Ship *ShipHandle::Get() const
+{
+	if(!generation)
+		return nullptr;
+	
+	const Entry &entry = GetEntry(index);
+	if(entry.generation.load(memory_order_acquire) != generation)
+		return nullptr;
+	Ship *ship = entry.ship.load(memory_order_acquire);
+	// If the generation is still the same, the ship was not yet destroyed when
+	// it was read.
+	return (entry.generation.load(memory_order_relaxed) == generation) ? ship : nullptr;
+}
+
+
+
+// Mark that the calling thread is about to follow handles (possibly with the
+// help of the worker pool), or is done doing so.
+void ShipHandle::BeginFollowing()
+{
+	followingThread.store(this_thread::get_id(), memory_order_relaxed);
+}
+
+
+
+void ShipHandle::EndFollowing()
+{
+	followingThread.store(thread::id(), memory_order_relaxed);
+}
+
+
+
+ShipHandle::operator bool() const
+{
+	return Get();
+}
+
+
+
+bool ShipHandle::operator==(const ShipHandle &other) const
+{
+	return (Get() == other.Get());
+}
+
+
+
+bool ShipHandle::operator!=(const ShipHandle &other) const
+{
+	return !(*this == other);
+}
+
+
+
+// Get the index of this handle's slot in the registry.
+uint32_t ShipHandle::Index() const
+{
+	return index;
+}
+
+
+
+// Get a number that identifies the ship this handle was made for.
+uint64_t ShipHandle::ID() const
+{
+	return (static_cast<uint64_t>(generation) << 32) | index;
+}
@@ -0,0 +1,84 @@
+/* ShipHandle.h
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef SHIP_HANDLE_H_
+#define SHIP_HANDLE_H_
+
+#include <atomic>
+#include <cstdint>
+
+class Ship;
+
+
+
+// A reference to a ship which, like a weak_ptr, becomes null once that ship is
+// destroyed, but which can be checked and followed without touching any
+// reference counts. Each ship that has ever been referred to this way has a
+// slot in a registry, and a handle is the index of that slot plus a generation
+// number that changes whenever the slot is given to a different ship.
+// Following a handle does not keep its ship alive, so while one thread (and the
+// worker pool it is using) is following handles, no other thread may destroy a
+// ship that a handle may refer to. Debug builds check this.
+class ShipHandle {
+public:
+	// Each ship has one of these, holding its place in the registry. A ship is
+	// only given a place the first time a handle to it is made. Copying a ship
+	// does not copy its place.
+	class Slot {
+	public:
+		Slot() = default;
+		Slot(const Slot &) {}
+		Slot &operator=(const Slot &) { return *this; }
+		~Slot();
+	
+	private:
+		friend class ShipHandle;
+		// One more than the index of this slot, or zero if it has none yet.
+		mutable std::atomic<uint32_t> index{0};
+	};
+	
+	
+public:
+	ShipHandle() = default;
+	// Get a handle to the given ship, which may be null.
+	ShipHandle(const Ship *ship);
+	
+	// Get the ship this refers to, or null if it no longer exists.
+	Ship *Get() const;
+	explicit operator bool() const;
+	
+	bool operator==(const ShipHandle &other) const;
+	bool operator!=(const ShipHandle &other) const;
+	
+	// Get the index of this handle's slot in the registry. No two ships that
+	// exist at the same time share a slot, so this can be used to store
+	// information about ships in a vector instead of a map.
+	uint32_t Index() const;
+	// Get a number that identifies the ship this handle was made for. Handles
+	// to different ships never have the same ID, even after a ship is gone.
+	uint64_t ID() const;
+	
+	// Mark the time during which the calling thread follows handles. Until
+	// EndFollowing() is called, only this thread may destroy ships.
+	static void BeginFollowing();
+	static void EndFollowing();
+	
+	
+private:
+	uint32_t index = 0;
+	// Generation zero is never used, so this is a null handle.
+	uint32_t generation = 0;
+};
+
+
+
+#endif
@@ -52,24 +52,31 @@ void Sprite::AddFrame(int frame, ImageBuffer *image, Mask *mask, bool is2x)
 	vector<uint32_t> &textureIndex = (is2x ? textures2x : textures);
 	if(textureIndex.size() <= static_cast<unsigned>(frame))
 		textureIndex.resize(frame + 1, 0);
-	if(!textureIndex[frame])
-		glGenTextures(1, &textureIndex[frame]);
-	glBindTexture(GL_TEXTURE_2D, textureIndex[frame]);
 	
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	
-	if(Preferences::Has("Reduce large graphics") && image->Width() * image->Height() >= 1000000)
-		image->ShrinkToHalfSize();
-	
-	// ImageBuffer always loads images into 32-bit BGRA buffers.
-	// That is supposedly the fastest format to upload.
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image->Width(), image->Height(), 0,
-		GL_BGRA, GL_UNSIGNED_BYTE, image->Pixels());
-	
-	glBindTexture(GL_TEXTURE_2D, 0);
+	// When running headless there is no OpenGL context to upload to. The frame
+	// is still recorded (with a null texture) so that animation frame counts
+	// and collision masks behave exactly as they would with a window.
+	if(SDL_GL_GetCurrentContext())
+	{
+		if(!textureIndex[frame])
+			glGenTextures(1, &textureIndex[frame]);
+		glBindTexture(GL_TEXTURE_2D, textureIndex[frame]);
+		
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		
+		if(Preferences::Has("Reduce large graphics") && image->Width() * image->Height() >= 1000000)
+			image->ShrinkToHalfSize();
+		
+		// ImageBuffer always loads images into 32-bit BGRA buffers.
+		// That is supposedly the fastest format to upload.
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image->Width(), image->Height(), 0,
+			GL_BGRA, GL_UNSIGNED_BYTE, image->Pixels());
+		
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
 	delete image;
 	
 	if(mask)
@@ -86,14 +93,18 @@ void Sprite::AddFrame(int frame, ImageBuffer *image, Mask *mask, bool is2x)
 // Free up all textures loaded for this sprite.
 void Sprite::Unload()
 {
+	// Without an OpenGL context, no textures were ever actually created.
+	bool hasContext = SDL_GL_GetCurrentContext();
 	if(!textures.empty())
 	{
-		glDeleteTextures(textures.size(), &textures.front());
+		if(hasContext)
+			glDeleteTextures(textures.size(), &textures.front());
 		textures.clear();
 	}
 	if(!textures2x.empty())
 	{
-		glDeleteTextures(textures2x.size(), &textures2x.front());
+		if(hasContext)
+			glDeleteTextures(textures2x.size(), &textures2x.front());
 		textures2x.clear();
 	}
 	
@@ -188,6 +188,18 @@ void Weapon::LoadWeapon(const DataNode &node)
 
 
 
+// Once every outfit has been loaded, calculate the values that depend on
+// this weapon's submunitions. These are read from several threads at once,
+// so they must not be calculated the first time they are asked for.
+void Weapon::FinishLoadingWeapon()
+{
+	for(int i = 0; i < 6; ++i)
+		totalDamage[i] = CalculateTotalDamage(i);
+	totalLifetime = CalculateTotalLifetime();
+}
+
+
+
 bool Weapon::IsWeapon() const
 {
 	return isWeapon;
@@ -267,20 +279,6 @@ const map<const Outfit *, int> &Weapon::Submunitions() const
 
 
 
-double Weapon::TotalLifetime() const
-{
-	if(totalLifetime < 0.)
-	{
-		totalLifetime = 0.;
-		for(const auto &it : submunitions)
-			totalLifetime = max(totalLifetime, it.first->TotalLifetime());
-		totalLifetime += lifetime;
-	}
-	return totalLifetime;
-}
-
-
-
 double Weapon::Range() const
 {
 	return Velocity() * TotalLifetime();
@@ -297,13 +295,20 @@ void Weapon::SetTurretTurn(double rate)
 
 
 
-double Weapon::TotalDamage(int index) const
+double Weapon::CalculateTotalDamage(int index) const
 {
-	if(!calculatedDamage[index])
-	{
-		calculatedDamage[index] = true;
-		for(const auto &it : submunitions)
-			damage[index] += it.first->TotalDamage(index) * it.second;
-	}
-	return damage[index];
+	double result = damage[index];
+	for(const auto &it : submunitions)
+		result += it.first->CalculateTotalDamage(index) * it.second;
+	return result;
+}
+
+
+
+double Weapon::CalculateTotalLifetime() const
+{
+	double result = 0.;
+	for(const auto &it : submunitions)
+		result = max(result, it.first->CalculateTotalLifetime());
+	return result + lifetime;
 }
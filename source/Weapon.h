@@ -34,6 +34,9 @@ class Weapon {
 public:
 	// Load from a "weapon" node, either in an outfit or in a ship (explosion).
 	void LoadWeapon(const DataNode &node);
+	// Once every outfit has been loaded, calculate the values that depend on
+	// this weapon's submunitions.
+	void FinishLoadingWeapon();
 	bool IsWeapon() const;
 	
 	// Get assets used by this weapon.
@@ -119,7 +122,8 @@ protected:
 	
 	
 private:
-	double TotalDamage(int index) const;
+	double CalculateTotalDamage(int index) const;
+	double CalculateTotalLifetime() const;
 	
 	
 private:
@@ -184,13 +188,14 @@ private:
 	static const int ION_DAMAGE = 3;
 	static const int DISRUPTION_DAMAGE = 4;
 	static const int SLOWING_DAMAGE = 5;
-	mutable double damage[6] = {0., 0., 0., 0., 0., 0.};
+	double damage[6] = {0., 0., 0., 0., 0., 0.};
 	
 	double piercing = 0.;
 	
-	// Cache the calculation of these values, for faster access.
-	mutable bool calculatedDamage[6] = {false, false, false, false, false, false};
-	mutable double totalLifetime = -1.;
+	// These values include this weapon's submunitions. They are calculated
+	// once all outfits are loaded, for faster access.
+	double totalDamage[6] = {0., 0., 0., 0., 0., 0.};
+	double totalLifetime = 0.;
 };
 
 
@@ -230,6 +235,7 @@ inline double Weapon::FiringHeat() const { return firingHeat; }
 inline double Weapon::Piercing() const { return piercing; }
 
 inline double Weapon::SplitRange() const { return splitRange; }
+inline double Weapon::TotalLifetime() const { return totalLifetime; }
 inline double Weapon::TriggerRadius() const { return triggerRadius; }
 inline double Weapon::BlastRadius() const { return blastRadius; }
 inline double Weapon::HitForce() const { return hitForce; }
@@ -237,12 +243,12 @@ inline double Weapon::HitForce() const { return hitForce; }
 inline bool Weapon::IsSafe() const { return isSafe; }
 inline bool Weapon::IsPhasing() const { return isPhasing; }
 
-inline double Weapon::ShieldDamage() const { return TotalDamage(SHIELD_DAMAGE); }
-inline double Weapon::HullDamage() const { return TotalDamage(HULL_DAMAGE); }
-inline double Weapon::HeatDamage() const { return TotalDamage(HEAT_DAMAGE); }
-inline double Weapon::IonDamage() const { return TotalDamage(ION_DAMAGE); }
-inline double Weapon::DisruptionDamage() const { return TotalDamage(DISRUPTION_DAMAGE); }
-inline double Weapon::SlowingDamage() const { return TotalDamage(SLOWING_DAMAGE); }
+inline double Weapon::ShieldDamage() const { return totalDamage[SHIELD_DAMAGE]; }
+inline double Weapon::HullDamage() const { return totalDamage[HULL_DAMAGE]; }
+inline double Weapon::HeatDamage() const { return totalDamage[HEAT_DAMAGE]; }
+inline double Weapon::IonDamage() const { return totalDamage[ION_DAMAGE]; }
+inline double Weapon::DisruptionDamage() const { return totalDamage[DISRUPTION_DAMAGE]; }
+inline double Weapon::SlowingDamage() const { return totalDamage[SLOWING_DAMAGE]; }
 
 
 
@@ -0,0 +1,234 @@
+/* WorkerPool.cpp
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "WorkerPool.h"
+
+#include "Random.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+	class Pool {
+	public:
+		Pool();
+		~Pool();
+		
+		void Run(int count, int blockSize, const function<void(int, int)> &function);
+		int Threads() const;
+	
+	
+	private:
+		// Thread entry point.
+		void Work();
+		// Claim and process blocks until there are none left.
+		void DoBlocks(const function<void(int, int)> *job, int count, int blockSize);
+	
+	
+	private:
+		vector<thread> threads;
+		
+		// Only one set of blocks can be processed at a time.
+		mutex runMutex;
+		
+		mutex lock;
+		condition_variable wake;
+		condition_variable done;
+		// The job that is currently being processed. The workers copy these
+		// values (under the lock) when they wake up.
+		const function<void(int, int)> *job = nullptr;
+		int count = 0;
+		int blockSize = 1;
+		int blocks = 0;
+		uint64_t generation = 0;
+		// Number of workers that are currently processing blocks.
+		int busy = 0;
+		bool terminate = false;
+		
+		atomic<int> next;
+		atomic<int> finished;
+	};
+	
+	
+	
+	Pool::Pool()
+		: next(0), finished(0)
+	{
+		// The calling thread also processes blocks, so only start one worker
+		// for each additional core.
+		unsigned cores = thread::hardware_concurrency();
+		threads.resize(cores > 1 ? cores - 1 : 0);
+		for(thread &t : threads)
+			t = thread(&Pool::Work, this);
+	}
+	
+	
+	
+	Pool::~Pool()
+	{
+		{
+			unique_lock<mutex> guard(lock);
+			terminate = true;
+		}
+		wake.notify_all();
+		for(thread &t : threads)
+			t.join();
+	}
+	
+	
+	
+	void Pool::Run(int count, int blockSize, const function<void(int, int)> &function)
+	{
+		if(count <= 0)
+			return;
+		blockSize = max(1, blockSize);
+		
+		// If there is only one block, or no workers, don't bother waking them.
+		if(threads.empty() || count <= blockSize)
+		{
+			for(int start = 0; start < count; start += blockSize)
+				function(start, min(count, start + blockSize));
+			return;
+		}
+		
+		lock_guard<mutex> runGuard(runMutex);
+		{
+			unique_lock<mutex> guard(lock);
+			// A worker that woke up too late for the previous job may still be
+			// checking whether any of its blocks are left.
+			done.wait(guard, [this]{ return !busy; });
+			
+			job = &function;
+			this->count = count;
+			this->blockSize = blockSize;
+			blocks = (count + blockSize - 1) / blockSize;
+			next = 0;
+			finished = 0;
+			++generation;
+		}
+		wake.notify_all();
+		
+		DoBlocks(&function, count, blockSize);
+		
+		unique_lock<mutex> guard(lock);
+		done.wait(guard, [this]{ return !busy && finished == blocks; });
+		job = nullptr;
+	}
+	
+	
+	
+	int Pool::Threads() const
+	{
+		return threads.size() + 1;
+	}
+	
+	
+	
+	void Pool::Work()
+	{
+		uint64_t seen = 0;
+		unique_lock<mutex> guard(lock);
+		while(true)
+		{
+			wake.wait(guard, [this, &seen]{ return terminate || generation != seen; });
+			if(terminate)
+				return;
+			
+			seen = generation;
+			const function<void(int, int)> *current = job;
+			int currentCount = count;
+			int currentSize = blockSize;
+			++busy;
+			guard.unlock();
+			
+			DoBlocks(current, currentCount, currentSize);
+			
+			guard.lock();
+			--busy;
+			done.notify_all();
+		}
+	}
+	
+	
+	
+	void Pool::DoBlocks(const function<void(int, int)> *job, int count, int blockSize)
+	{
+		while(true)
+		{
+			int start = blockSize * next++;
+			if(start >= count)
+				return;
+			
+			(*job)(start, min(count, start + blockSize));
+			++finished;
+		}
+	}
+	
+	
+	
+	Pool &GetPool()
+	{
+		static Pool pool;
+		return pool;
+	}
+}
+
+
+
+// Call the given function once for each block of the range [0, count).
+void WorkerPool::Run(int count, int blockSize, const function<void(int, int)> &function)
+{
+	GetPool().Run(count, blockSize, function);
+}
+
+
+
+// Call the given function once for each block, with its own random seed.
+void WorkerPool::RunSeeded(int count, int blockSize, const function<void(int, int)> &function)
+{
+	// This thread may process some of the blocks itself, so draw one more seed
+	// to reseed it with afterwards.
+	blockSize = max(1, blockSize);
+	vector<uint64_t> seeds(Blocks(count, blockSize) + 1);
+	for(uint64_t &seed : seeds)
+		seed = (static_cast<uint64_t>(Random::Int()) << 32) | Random::Int();
+	
+	Run(count, blockSize, [&seeds, &function, blockSize](int start, int end)
+	{
+		Random::Seed(seeds[start / blockSize]);
+		function(start, end);
+	});
+	Random::Seed(seeds.back());
+}
+
+
+
+// Get the number of blocks that Run() will divide the given range into.
+int WorkerPool::Blocks(int count, int blockSize)
+{
+	blockSize = max(1, blockSize);
+	return (count > 0) ? (count + blockSize - 1) / blockSize : 0;
+}
+
+
+
+int WorkerPool::Threads()
+{
+	return GetPool().Threads();
+}
@@ -0,0 +1,45 @@
+/* WorkerPool.h
+Copyright (c) 2014 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <functional>
+
+
+
+// A set of worker threads (one per additional CPU core) that the calculation
+// thread can use to process many independent items at once. The items are
+// divided into fixed-size blocks, and each idle thread (including the one that
+// asked for the work to be done) repeatedly claims the next unclaimed block.
+// The block boundaries depend only on the number of items and the block size,
+// never on how many threads there are, so work that seeds the random number
+// generator once per block gives the same results on any machine.
+class WorkerPool {
+public:
+	// Call the given function once for each block of the range [0, count), with
+	// the start and end of that block, and wait until all blocks are done. This
+	// must not be called from within one of the blocks.
+	static void Run(int count, int blockSize, const std::function<void(int, int)> &function);
+	// Like Run(), but before each block is processed, seed the random number
+	// generator with a value drawn for that block from this thread's generator.
+	// This makes the results the same no matter which thread does which block.
+	static void RunSeeded(int count, int blockSize, const std::function<void(int, int)> &function);
+	// Get the number of blocks that Run() will divide the given range into.
+	static int Blocks(int count, int blockSize);
+	// Get the number of threads that share the work, including the caller.
+	static int Threads();
+};
+
+
+
+#endif
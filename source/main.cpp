@@ -13,12 +13,14 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 */
 
 #include "Audio.h"
+#include "Benchmark.h"
 #include "Command.h"
 #include "Conversation.h"
 #include "ConversationPanel.h"
 #include "DataFile.h"
 #include "DataNode.h"
 #include "Dialog.h"
+#include "Engine.h"
 #include "Files.h"
 #include "Font.h"
 #include "FrameTimer.h"
@@ -26,9 +28,13 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "ImageBuffer.h"
 #include "MenuPanel.h"
 #include "Panel.h"
+#include "Planet.h"
 #include "PlayerInfo.h"
 #include "Preferences.h"
+#include "Recording.h"
 #include "Screen.h"
+#include "Ship.h"
+#include "ShipEvent.h"
 #include "SpriteSet.h"
 #include "SpriteShader.h"
 #include "UI.h"
@@ -36,12 +42,16 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "gl_header.h"
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <map>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -56,6 +66,11 @@ void AdjustViewport(SDL_Window *window);
 int DoError(string message, SDL_Window *window = nullptr, SDL_GLContext context = nullptr);
 void Cleanup(SDL_Window *window, SDL_GLContext context);
 Conversation LoadConversation();
+bool NewHeadlessPilot(PlayerInfo &player);
+void PrintStepTimes(int steps, double total, double longest);
+int RunHeadless(PlayerInfo &player, int steps);
+int RunBenchmarks(PlayerInfo &player, const string &path);
+int RunReplay(PlayerInfo &player, const string &path);
 
 
 
@@ -63,6 +78,9 @@ int main(int argc, char *argv[])
 {
 	Conversation conversation;
 	bool debugMode = false;
+	int headlessSteps = 0;
+	string benchmarkPath;
+	string replayPath;
 	for(const char *const *it = argv + 1; *it; ++it)
 	{
 		string arg = *it;
@@ -80,10 +98,31 @@ int main(int argc, char *argv[])
 			conversation = LoadConversation();
 		else if(arg == "-d" || arg == "--debug")
 			debugMode = true;
+		else if(arg == "--headless" && *(it + 1))
+			headlessSteps = max(1, atoi(*++it));
+		else if(arg == "--benchmark" && *(it + 1))
+			benchmarkPath = *++it;
+		else if(arg == "--record" && *(it + 1))
+			Engine::SetRecordingPath(*++it);
+		else if(arg == "--replay" && *(it + 1))
+			replayPath = *++it;
 	}
 	PlayerInfo player;
 	
 	try {
+		// In headless mode, no window, OpenGL context, or audio device is
+		// created. The game data is loaded and the simulation is stepped as
+		// fast as possible.
+		if(headlessSteps || !benchmarkPath.empty() || !replayPath.empty())
+		{
+			GameData::BeginLoad(argv);
+			if(!replayPath.empty())
+				return RunReplay(player, replayPath);
+			if(!benchmarkPath.empty())
+				return RunBenchmarks(player, benchmarkPath);
+			return RunHeadless(player, headlessSteps);
+		}
+		
 		SDL_Init(SDL_INIT_VIDEO);
 		
 		// Begin loading the game data.
@@ -380,6 +419,16 @@ void PrintHelp()
 	cerr << "    -r, --resources <path>: load resources from given directory." << endl;
 	cerr << "    -c, --config <path>: save user's files to given directory." << endl;
 	cerr << "    -d, --debug: turn on debugging features (e.g. caps lock slow motion)." << endl;
+	cerr << "    --data-cache: keep a cache of the parsed data files in the config" << endl;
+	cerr << "        directory, so unchanged files do not need to be parsed again." << endl;
+	cerr << "    --headless <steps>: run the given number of simulation steps without" << endl;
+	cerr << "        a window or sound, and report how long each step took." << endl;
+	cerr << "    --benchmark <path>: run the benchmark scenarios in the given file" << endl;
+	cerr << "        without a window or sound, and print the results as JSON." << endl;
+	cerr << "    --record <path>: record the player's input during each flight to the" << endl;
+	cerr << "        given file (keeping only the most recent flight) for --replay." << endl;
+	cerr << "    --replay <path>: replay a flight recorded with --record without a" << endl;
+	cerr << "        window or sound, and report how long each step took." << endl;
 	cerr << endl;
 	cerr << "Report bugs to: mzahniser@gmail.com" << endl;
 	cerr << "Home page: <https://endless-sky.github.io>" << endl;
@@ -546,3 +595,200 @@ Conversation LoadConversation()
 	return conversation.Substitute(subs);
 }
 
+
+
+// Start a new pilot for a headless run, so that every run has the same workload:
+// buy the cheapest ship available at the starting planet's shipyard.
+bool NewHeadlessPilot(PlayerInfo &player)
+{
+	player.New();
+	const Ship *model = nullptr;
+	if(player.GetPlanet())
+		for(const Ship *ship : player.GetPlanet()->Shipyard())
+			if(!model || ship->Cost() < model->Cost()
+					|| (ship->Cost() == model->Cost() && ship->ModelName() < model->ModelName()))
+				model = ship;
+	if(!model)
+	{
+		cerr << "Headless mode: no ship is for sale at the starting planet." << endl;
+		return false;
+	}
+	player.BuyShip(model, "Headless");
+	return true;
+}
+
+
+
+void PrintStepTimes(int steps, double total, double longest)
+{
+	cout << "Steps: " << steps << endl;
+	cout << "Total time: " << total << " s" << endl;
+	cout << "Steps per second: " << (total ? steps / total : 0.) << endl;
+	cout << "Mean step time: " << (steps ? 1000. * total / steps : 0.) << " ms" << endl;
+	cout << "Max step time: " << 1000. * longest << " ms" << endl;
+}
+
+
+
+// Run the given number of engine steps with no window, OpenGL context, or
+// audio, and print out how fast the simulation is running.
+int RunHeadless(PlayerInfo &player, int steps)
+{
+	// No textures will be uploaded, but the simulation still needs each
+	// sprite's dimensions and collision masks.
+	GameData::FinishLoading();
+	
+	if(!NewHeadlessPilot(player))
+		return 1;
+	
+	// Any dialogs or conversations that missions try to show are queued up in
+	// this UI, but it is never drawn.
+	UI ui;
+	if(!player.TakeOff(&ui))
+	{
+		cerr << "Headless mode: unable to take off from the starting planet." << endl;
+		return 1;
+	}
+	
+	Engine engine(player);
+	engine.Place();
+	
+	// The calculation thread only runs between Go() and Wait(), so timing that
+	// interval measures exactly one call to Engine::CalculateStep().
+	double total = 0.;
+	double longest = 0.;
+	for(int i = 0; i < steps; ++i)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		engine.Go();
+		engine.Wait();
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		total += elapsed;
+		longest = max(longest, elapsed);
+		
+		engine.Step(false);
+		for(const ShipEvent &event : engine.Events())
+			player.HandleEvent(event, &ui);
+	}
+	
+	PrintStepTimes(steps, total, longest);
+	return 0;
+}
+
+
+
+// Run every benchmark scenario defined in the given file, with no window,
+// OpenGL context, or audio, and print the results as a JSON array.
+int RunBenchmarks(PlayerInfo &player, const string &path)
+{
+	GameData::FinishLoading();
+	
+	vector<Benchmark> benchmarks;
+	DataFile file(path);
+	for(const DataNode &node : file)
+	{
+		if(node.Token(0) == "benchmark")
+		{
+			benchmarks.emplace_back();
+			benchmarks.back().Load(node);
+		}
+		else
+			node.PrintTrace("Skipping unrecognized root object:");
+	}
+	if(benchmarks.empty())
+	{
+		cerr << "No benchmarks found in \"" << path << "\"." << endl;
+		return 1;
+	}
+	
+	cout << "[" << endl;
+	bool isFirst = true;
+	for(const Benchmark &benchmark : benchmarks)
+	{
+		cerr << "Running benchmark \"" << benchmark.Name() << "\"..." << endl;
+		if(!isFirst)
+			cout << "," << endl;
+		isFirst = false;
+		if(!benchmark.Run(player, cout))
+			return 1;
+	}
+	cout << endl << "]" << endl;
+	
+	return 0;
+}
+
+
+
+// Replay a recorded flight with no window, OpenGL context, or audio. Every call
+// that passed player input to the engine is repeated in the same order, so the
+// simulation is exactly the same as when it was recorded.
+int RunReplay(PlayerInfo &player, const string &path)
+{
+	GameData::FinishLoading();
+	
+	Recording recording;
+	if(!recording.Load(path))
+	{
+		cerr << "Replay: \"" << path << "\" is not a recording." << endl;
+		return 1;
+	}
+	// A flight that was recorded in headless mode did not start from a saved
+	// game, but from a new pilot.
+	if(recording.Pilot().empty())
+	{
+		if(!NewHeadlessPilot(player))
+			return 1;
+	}
+	else
+		player.Load(recording.Pilot());
+	
+	UI ui;
+	if(!player.TakeOff(&ui))
+	{
+		cerr << "Replay: unable to take off from the starting planet." << endl;
+		return 1;
+	}
+	
+	Engine engine(player);
+	engine.Replay(recording);
+	engine.Place();
+	
+	// Each step is calculated right away instead of while the next frame is
+	// being drawn, so that it can be timed.
+	int steps = 0;
+	double total = 0.;
+	double longest = 0.;
+	auto calculate = [&]()
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		engine.Go();
+		engine.Wait();
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		total += elapsed;
+		longest = max(longest, elapsed);
+		++steps;
+	};
+	for(const Recording::Input &input : recording.Inputs())
+	{
+		if(input.type == Recording::Input::STEP)
+			for(int i = 0; i < input.count; ++i)
+			{
+				engine.Step(input.isActive, input.keys, input.shift, input.zoom);
+				for(const ShipEvent &event : engine.Events())
+					player.HandleEvent(event, &ui);
+				if(input.go)
+					calculate();
+			}
+		else if(input.type == Recording::Input::GO)
+			calculate();
+		else if(input.type == Recording::Input::CLICK)
+			engine.Click(input.from, input.to, input.shift);
+		else if(input.type == Recording::Input::RCLICK)
+			engine.RClick(input.from);
+		else if(input.type == Recording::Input::GROUP)
+			engine.SelectGroup(input.group, input.shift, input.control);
+	}
+	
+	PrintStepTimes(steps, total, longest);
+	return 0;
+}